@@ -3,6 +3,7 @@
   Copyright 2019 Thomas Mout
 */
 
+#include <stdarg.h>
 #include <EEPROM.h>
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
@@ -10,12 +11,27 @@
 #include <Adafruit_GFX.h>
 #include <WEMOS_Matrix_GFX.h>
 #include "FS.h"
+#include "EventStream.h"
+#include "LatencyHistogram.h"
+#include "Scheduler.h"
+#include "VmixConnection.h"
 
 // Constants
 const int SsidMaxLength = 64;
 const int PassMaxLength = 64;
 const int HostNameMaxLength = 64;
-const int TallyNumberMaxValue = 64;
+const int TallyNumberMaxValue = 1000;
+const int OverlayChannels = 4;
+const int HeartbeatMissesMaxValue = 10;
+
+// Which of the primary and backup vMix host the tally follows
+const uint8_t HostPolicyPrimary = 0;
+const uint8_t HostPolicyRace = 1;
+const uint8_t HostPolicyLive = 2;
+
+// How tally changes are received from vMix
+const uint8_t TallyModeTally = 0;
+const uint8_t TallyModeActs = 1;
 
 // Settings object
 struct Settings
@@ -24,6 +40,16 @@ struct Settings
   char pass[PassMaxLength];
   char hostName[HostNameMaxLength];
   int tallyNumber;
+  uint8_t tallyMode;
+  // More inputs showing the same camera, 0 when unused
+  uint16_t extraInputs[TallyInputsMaxValue - 1];
+  // Overlay channels that count as program, one bit per channel
+  uint8_t overlayMask;
+  // Missed heartbeats before the connection to vMix is dropped, 0 is off
+  uint8_t heartbeatMisses;
+  // Backup vMix host, empty when unused
+  char backupHostName[HostNameMaxLength];
+  uint8_t hostPolicy;
 };
 
 // Default settings object
@@ -31,18 +57,81 @@ Settings defaultSettings = {
   "ssid default",
   "pass default",
   "hostname default",
-  1
+  1,
+  TallyModeTally,
+  {0},
+  (1 << OverlayChannels) - 1,
+  3,
+  "",
+  HostPolicyPrimary
 };
 
 Settings settings;
 
+// Settings are stored as one record with a version and a CRC
+const int EepromSize = 512;
+const int SettingsAddress = 0;
+const uint16_t SettingsMagic = 0x5654;
+const uint16_t SettingsVersion = 1;
+
+struct SettingsRecord
+{
+  uint16_t magic;
+  uint16_t version;
+  uint32_t crc;
+  Settings settings;
+};
+
+// Last successful WiFi connection, stored after the settings for a fast reconnect.
+// The address leaves room for the settings record and stays fixed, a record that
+// outgrows it needs a new version and not a moved cache.
+const int WifiCacheAddress = 384;
+const uint8_t WifiCacheMagic = 0xA5;
+
+// Only the access point is cached, the address always comes from DHCP so its lease is renewed
+struct WifiCache
+{
+  uint8_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+};
+
+WifiCache wifiCache;
+
+static_assert(SettingsAddress + sizeof(SettingsRecord) <= WifiCacheAddress, "Settings record overlaps the WiFi cache");
+static_assert(WifiCacheAddress + sizeof(WifiCache) <= EepromSize, "WiFi cache does not fit in the EEPROM");
+
 // HTTP Server settings
 ESP8266WebServer httpServer(80);
+const char *pageHeaders[] = {"If-None-Match"};
 char deviceName[32];
 int status = WL_IDLE_STATUS;
 bool apEnabled = false;
 char apPass[64];
 
+// WiFi settings
+const unsigned long WifiTimeout = 15000;
+const unsigned long WifiFastTimeout = 3000;
+bool wifiConnecting = false;
+bool wifiFast = false;
+unsigned long wifiStart = 0;
+
+// Boot stage timestamps
+enum BootStage
+{
+  BootSetup,
+  BootSettings,
+  BootWifiBegin,
+  BootWifiConnected,
+  BootVmixConnected,
+  BootFirstTally,
+  BootStageCount
+};
+
+const char *bootStageNames[BootStageCount] = {"Setup", "Settings loaded", "WiFi begin", "WiFi connected", "vMix connected", "First tally"};
+unsigned long bootStages[BootStageCount];
+uint8_t bootStagesSeen = 0;
+
 // vMix settings
 int port = 8099;
 
@@ -55,101 +144,199 @@ const char tallyStateOff = 0;
 const char tallyStateProgram = 1;
 const char tallyStatePreview = 2;
 
-// LED characters
-static const uint8_t PROGMEM C[] = {B00000000, B01111110, B11111111, B10000001, B10000001, B11000011, B01000010, B00000000};
-static const uint8_t PROGMEM L[] = {B00000000, B11111111, B11111111, B11000000, B11000000, B11000000, B11000000, B00000000};
-static const uint8_t PROGMEM P[] = {B00000000, B11111111, B11111111, B00010001, B00010001, B00011111, B00001110, B00000000};
-static const uint8_t PROGMEM S[] = {B00000000, B01001100, B11011110, B10010010, B10010010, B11110110, B01100100, B00000000};
+// Latency measurement, in microseconds
+LatencyHistogram latencyDecide;
+LatencyHistogram latencyDisplay;
+LatencyHistogram latencyTotal;
+bool latencyPending = false;
+uint32_t latencyReceived = 0;
+uint32_t latencyDecided = 0;
+
+// Metrics
+LatencyHistogram loopTime;
+unsigned long stateChanges = 0;
+
+// Work done from loop(), in order of priority, budgets in microseconds
+const uint32_t FrameBudget = 10000;
+Scheduler scheduler(FrameBudget);
+
+// Live events to browsers
+EventStream events;
+const unsigned long RssiInterval = 5000;
+unsigned long rssiSampled = 0;
+
+// HTTP responses are streamed in chunks from this buffer
+char chunkBuffer[512];
+size_t chunkLength = 0;
+
+// LED characters, converted to display frames at compile time
+static const uint8_t C[8] = MLED_FRAME(B00000000, B01111110, B11111111, B10000001, B10000001, B11000011, B01000010, B00000000);
+static const uint8_t L[8] = MLED_FRAME(B00000000, B11111111, B11111111, B11000000, B11000000, B11000000, B11000000, B00000000);
+static const uint8_t P[8] = MLED_FRAME(B00000000, B11111111, B11111111, B00010001, B00010001, B00011111, B00001110, B00000000);
+static const uint8_t S[8] = MLED_FRAME(B00000000, B01001100, B11011110, B10010010, B10010010, B11110110, B01100100, B00000000);
+
+// The vMix connection
+void handleTally(char newState);
+void handleResponse(const char *response);
+void handleConnection(VmixConnection::State state);
+VmixConnection vmix(handleTally, handleResponse, handleConnection);
+
+// The backup vMix host is kept connected, so switching over never waits for a connection
+void handleBackupTally(char newState);
+void handleBackupConnection(VmixConnection::State state);
+VmixConnection vmixBackup(handleBackupTally, handleResponse, handleBackupConnection);
+const char *hostPolicyNames[] = {"primary", "race", "live"};
+
+// The connection the tally follows and the last state of each host, -1 when unknown
+VmixConnection *following = NULL;
+char primaryState = -1;
+char backupState = -1;
+
+// Time from losing the followed host until the LED shows another one, in microseconds
+LatencyHistogram switchoverTime;
+unsigned long switchovers = 0;
+VmixConnection *lostHost = NULL;
+uint32_t lostAt = 0;
+bool switchoverPending = false;
+
+// Add bytes to a running CRC-32, start at 0xFFFFFFFF and invert the result
+uint32_t crcUpdate(uint32_t crc, const void *data, size_t size)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
 
-// The WiFi client
-WiFiClient client;
-int timeout = 10;
-int delayTime = 10000;
+  for (size_t i = 0; i < size; i++)
+  {
+    crc ^= bytes[i];
 
-// Time measure
-int interval = 5000;
-unsigned long lastCheck = 0;
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
 
-// Load settings from EEPROM
-void loadSettings()
+  return crc;
+}
+
+// CRC-32 of the stored settings
+uint32_t settingsCrc(const Settings &data)
 {
-  Serial.println("------------");
-  Serial.println("Loading settings");
+  return ~crcUpdate(0xFFFFFFFF, &data, sizeof(Settings));
+}
+
+// Copy settings with everything after the string terminators zeroed, so equal settings store equal bytes
+void packSettings(Settings &packed, const Settings &source)
+{
+  memset(&packed, 0, sizeof(Settings));
+  memcpy(packed.ssid, source.ssid, strnlen(source.ssid, SsidMaxLength - 1));
+  memcpy(packed.pass, source.pass, strnlen(source.pass, PassMaxLength - 1));
+  memcpy(packed.hostName, source.hostName, strnlen(source.hostName, HostNameMaxLength - 1));
+  packed.tallyNumber = source.tallyNumber;
+  packed.tallyMode = source.tallyMode;
+  memcpy(packed.extraInputs, source.extraInputs, sizeof(packed.extraInputs));
+  packed.overlayMask = source.overlayMask;
+  packed.heartbeatMisses = source.heartbeatMisses;
+  memcpy(packed.backupHostName, source.backupHostName, strnlen(source.backupHostName, HostNameMaxLength - 1));
+  packed.hostPolicy = source.hostPolicy;
+}
 
-  long ptr = 0;
+// Read the byte by byte layout of earlier firmware, false if it holds no valid settings
+bool loadLegacySettings(Settings &legacy)
+{
+  int ptr = 0;
+
+  legacy = defaultSettings;
 
   for (int i = 0; i < SsidMaxLength; i++)
   {
-    settings.ssid[i] = EEPROM.read(ptr);
-    ptr++;
+    legacy.ssid[i] = EEPROM.read(ptr++);
   }
 
   for (int i = 0; i < PassMaxLength; i++)
   {
-    settings.pass[i] = EEPROM.read(ptr);
-    ptr++;
+    legacy.pass[i] = EEPROM.read(ptr++);
   }
 
   for (int i = 0; i < HostNameMaxLength; i++)
   {
-    settings.hostName[i] = EEPROM.read(ptr);
-    ptr++;
+    legacy.hostName[i] = EEPROM.read(ptr++);
   }
 
-  settings.tallyNumber = EEPROM.read(ptr);
+  legacy.tallyNumber = EEPROM.read(ptr);
+
+  return memchr(legacy.ssid, 0, SsidMaxLength) != NULL && strlen(legacy.ssid) > 0 &&
+         memchr(legacy.pass, 0, PassMaxLength) != NULL && strlen(legacy.pass) > 0 &&
+         memchr(legacy.hostName, 0, HostNameMaxLength) != NULL && strlen(legacy.hostName) > 0 &&
+         legacy.tallyNumber > 0 && legacy.tallyNumber <= TallyNumberMaxValue;
+}
+
+// Load settings from EEPROM
+void loadSettings()
+{
+  Serial.println("------------");
+  Serial.println("Loading settings");
+
+  SettingsRecord record;
+  EEPROM.get(SettingsAddress, record);
 
-  if (strlen(settings.ssid) == 0 || strlen(settings.pass) == 0 || strlen(settings.hostName) == 0 || settings.tallyNumber == 0)
+  if (record.magic == SettingsMagic && record.version == SettingsVersion && record.crc == settingsCrc(record.settings))
   {
-    Serial.println("No settings found");
+    settings = record.settings;
+    Serial.println("Settings loaded");
+  }
+  // The magic reads "TV", an earlier firmware stored an SSID starting with it there
+  else if (loadLegacySettings(record.settings))
+  {
+    Serial.println("Migrating settings of earlier firmware");
+    settings = record.settings;
+    saveSettings();
+  }
+  else if (record.magic == SettingsMagic)
+  {
+    Serial.print("Settings corrupted or of unknown version ");
+    Serial.println(record.version);
     Serial.println("Loading default settings");
     settings = defaultSettings;
     saveSettings();
-    restart();
   }
   else
   {
-    Serial.println("Settings loaded");
-    printSettings();
-    Serial.println("------------");
+    Serial.println("No settings found");
+    Serial.println("Loading default settings");
+    settings = defaultSettings;
+    saveSettings();
   }
+
+  printSettings();
+  Serial.println("------------");
 }
 
-// Save settings to EEPROM
+// Save settings to EEPROM as one record, only when they changed
 void saveSettings()
 {
   Serial.println("------------");
   Serial.println("Saving settings");
 
-  long ptr = 0;
+  SettingsRecord record;
+  SettingsRecord stored;
 
-  for (int i = 0; i < 512; i++)
-  {
-    EEPROM.write(i, 0);
-  }
+  record.magic = SettingsMagic;
+  record.version = SettingsVersion;
+  packSettings(record.settings, settings);
+  record.crc = settingsCrc(record.settings);
 
-  for (int i = 0; i < SsidMaxLength; i++)
-  {
-    EEPROM.write(ptr, settings.ssid[i]);
-    ptr++;
-  }
+  EEPROM.get(SettingsAddress, stored);
 
-  for (int i = 0; i < PassMaxLength; i++)
+  if (memcmp(&record, &stored, sizeof(SettingsRecord)) == 0)
   {
-    EEPROM.write(ptr, settings.pass[i]);
-    ptr++;
+    Serial.println("Settings unchanged");
   }
-
-  for (int i = 0; i < HostNameMaxLength; i++)
+  else
   {
-    EEPROM.write(ptr, settings.hostName[i]);
-    ptr++;
+    EEPROM.put(SettingsAddress, record);
+    EEPROM.commit();
+    Serial.println("Settings saved");
   }
 
-  EEPROM.write(ptr, settings.tallyNumber);
-
-  EEPROM.commit();
-
-  Serial.println("Settings saved");
   printSettings();
   Serial.println("------------");
 }
@@ -166,6 +353,173 @@ void printSettings()
   Serial.println(settings.hostName);
   Serial.print("Tally number: ");
   Serial.println(settings.tallyNumber);
+  Serial.print("Tally mode: ");
+  Serial.println(settings.tallyMode == TallyModeActs ? "ACTS" : "TALLY");
+  Serial.print("Extra inputs: ");
+  Serial.println(formatInputs());
+  Serial.print("Overlay channels: ");
+  Serial.println(formatOverlays());
+  Serial.print("Heartbeat misses: ");
+  Serial.println(settings.heartbeatMisses);
+  Serial.print("vMix backup hostname: ");
+  Serial.println(settings.backupHostName);
+  Serial.print("Host policy: ");
+  Serial.println(hostPolicyNames[settings.hostPolicy]);
+}
+
+// Comma separated list of the extra inputs
+const char *formatInputs()
+{
+  static char buffer[TallyInputsMaxValue * 6];
+  int length = 0;
+
+  buffer[0] = '\0';
+
+  for (int i = 0; i < TallyInputsMaxValue - 1; i++)
+  {
+    if (settings.extraInputs[i] > 0)
+    {
+      length += snprintf(buffer + length, sizeof(buffer) - length, length ? ",%u" : "%u", settings.extraInputs[i]);
+    }
+  }
+
+  return buffer;
+}
+
+// Comma separated list of the overlay channels that count as program
+const char *formatOverlays()
+{
+  static char buffer[OverlayChannels * 2 + 1];
+  int length = 0;
+
+  buffer[0] = '\0';
+
+  for (int i = 0; i < OverlayChannels; i++)
+  {
+    if (settings.overlayMask & (1 << i))
+    {
+      length += snprintf(buffer + length, sizeof(buffer) - length, length ? ",%d" : "%d", i + 1);
+    }
+  }
+
+  return buffer;
+}
+
+// Parse a comma separated list of numbers from 1 to maxValue, unused values are set to 0
+bool parseList(const char *text, int maxValue, uint16_t *values, int maxCount)
+{
+  int count = 0;
+
+  memset(values, 0, maxCount * sizeof(uint16_t));
+
+  while (*text)
+  {
+    char *end;
+    long value = strtol(text, &end, 10);
+
+    if (end == text || value < 1 || value > maxValue || count == maxCount)
+    {
+      return false;
+    }
+
+    values[count++] = value;
+
+    for (text = end; *text == ' ' || *text == ','; text++)
+    {
+    }
+  }
+
+  return true;
+}
+
+// Follow the tally number, the extra inputs and the selected overlay channels
+void followInputs()
+{
+  uint16_t inputs[TallyInputsMaxValue];
+  int count = 0;
+
+  inputs[count++] = settings.tallyNumber;
+
+  for (int i = 0; i < TallyInputsMaxValue - 1; i++)
+  {
+    if (settings.extraInputs[i] > 0)
+    {
+      inputs[count++] = settings.extraInputs[i];
+    }
+  }
+
+  vmix.setInputs(inputs, count, settings.overlayMask);
+  vmixBackup.setInputs(inputs, count, settings.overlayMask);
+}
+
+// Load the cached WiFi connection from EEPROM
+void loadWifiCache()
+{
+  EEPROM.get(WifiCacheAddress, wifiCache);
+}
+
+// Save the current WiFi connection to EEPROM, only when it changed
+void saveWifiCache()
+{
+  WifiCache newCache;
+
+  // Zero the padding after bssid, the cache is compared as bytes
+  memset(&newCache, 0, sizeof(WifiCache));
+  newCache.magic = WifiCacheMagic;
+  memcpy(newCache.bssid, WiFi.BSSID(), sizeof(newCache.bssid));
+  newCache.channel = WiFi.channel();
+
+  if (memcmp(&newCache, &wifiCache, sizeof(WifiCache)) != 0)
+  {
+    wifiCache = newCache;
+    EEPROM.put(WifiCacheAddress, wifiCache);
+    EEPROM.commit();
+    Serial.println("WiFi cache saved");
+  }
+}
+
+// Forget the cached WiFi connection, it belongs to the previous network
+void clearWifiCache()
+{
+  wifiCache.magic = 0;
+  EEPROM.put(WifiCacheAddress, wifiCache);
+}
+
+// Record the first time a boot stage is reached
+void bootStage(BootStage stage)
+{
+  if (bootStagesSeen & (1 << stage))
+  {
+    return;
+  }
+
+  bootStages[stage] = millis();
+  bootStagesSeen |= 1 << stage;
+
+  if (stage == BootFirstTally)
+  {
+    printBootStages();
+  }
+}
+
+// Print boot stage timestamps
+void printBootStages()
+{
+  Serial.println("------------");
+  Serial.println("Boot stages");
+
+  for (int i = 0; i < BootStageCount; i++)
+  {
+    if (bootStagesSeen & (1 << i))
+    {
+      Serial.print(bootStageNames[i]);
+      Serial.print(": ");
+      Serial.print(bootStages[i]);
+      Serial.println(" ms");
+    }
+  }
+
+  Serial.println("------------");
 }
 
 // Set led intensity from 0 to 7
@@ -178,43 +532,39 @@ void ledSetIntensity(int intensity)
 void ledSetOff()
 {
   matrix.clear();
-  matrix.writeDisplay();
+  matrix.present();
 }
 
 // Draw L(ive) with LED's
 void ledSetProgram()
 {
-  matrix.clear();
-  matrix.drawBitmap(0, 0, L, 8, 8, LED_ON);
+  matrix.setFrame(L);
   ledSetIntensity(7);
-  matrix.writeDisplay();
+  matrix.present();
 }
 
 // Draw P(review) with LED's
 void ledSetPreview()
 {
-  matrix.clear();
-  matrix.drawBitmap(0, 0, P, 8, 8, LED_ON);
+  matrix.setFrame(P);
   ledSetIntensity(2);
-  matrix.writeDisplay();
+  matrix.present();
 }
 
 // Draw C(onnecting) with LED's
 void ledSetConnecting()
 {
-  matrix.clear();
-  matrix.drawBitmap(0, 0, C, 8, 8, LED_ON);
+  matrix.setFrame(C);
   ledSetIntensity(7);
-  matrix.writeDisplay();
+  matrix.present();
 }
 
 // Draw S(ettings) with LED's
 void ledSetSettings()
 {
-  matrix.clear();
-  matrix.drawBitmap(0, 0, S, 8, 8, LED_ON);
+  matrix.setFrame(S);
   ledSetIntensity(7);
-  matrix.writeDisplay();
+  matrix.present();
 }
 
 // Set tally to off
@@ -230,7 +580,6 @@ void tallySetProgram()
 {
   Serial.println("Tally program");
 
-  ledSetOff();
   ledSetProgram();
 }
 
@@ -239,262 +588,1230 @@ void tallySetPreview()
 {
   Serial.println("Tally preview");
 
-  ledSetOff();
   ledSetPreview();
 }
 
 // Set tally to connecting
 void tallySetConnecting()
 {
-  ledSetOff();
+  // No state is shown, the next one is shown whatever it is
+  currentState = -1;
   ledSetConnecting();
 }
 
-// Handle incoming data
-void handleData(String data)
+// Handle a tally state received from the primary vMix host
+void handleTally(char newState)
 {
-  // Check if server data is tally data
-  if (data.indexOf("TALLY") == 0)
+  primaryState = newState;
+
+  if (following == &vmix)
   {
-    char newState = data.charAt(settings.tallyNumber + 8);
+    showTally(newState, vmix.receivedCycles);
+  }
+}
 
-    // Check if tally state has changed
-    if (currentState != newState)
-    {
-      currentState = newState;
+// Handle a tally state received from the backup vMix host
+void handleBackupTally(char newState)
+{
+  backupState = newState;
 
-      switch (currentState)
-      {
-        case '0':
-          tallySetOff();
-          break;
-        case '1':
-          tallySetProgram();
-          break;
-        case '2':
-          tallySetPreview();
-          break;
-        default:
-          tallySetOff();
-      }
-    }
-  }
-  else
+  if (following == &vmixBackup)
   {
-    Serial.print("Response from vMix: ");
-    Serial.println(data);
+    showTally(newState, vmixBackup.receivedCycles);
   }
 }
 
-// Start access point
-void apStart()
+// Show a tally state of the followed host
+void showTally(char newState, uint32_t receivedCycles)
 {
-  ledSetSettings();
-  Serial.println("AP Start");
-  Serial.print("AP SSID: ");
-  Serial.println(deviceName);
-  Serial.print("AP password: ");
-  Serial.println(apPass);
+  // Check if tally state has changed
+  if (currentState != newState)
+  {
+    latencyReceived = receivedCycles;
+    latencyDecided = ESP.getCycleCount();
+    latencyDecide.record(cyclesToMicros(latencyDecided - latencyReceived));
+    latencyPending = true;
 
-  WiFi.mode(WIFI_AP);
-  WiFi.hostname(deviceName);
-  WiFi.softAP(deviceName, apPass);
-  delay(100);
-  IPAddress myIP = WiFi.softAPIP();
-  Serial.print("IP address: ");
-  Serial.println(myIP);
+    currentState = newState;
+    stateChanges++;
+    bootStage(BootFirstTally);
+    sendTallyEvent();
 
-  apEnabled = true;
+    switch (currentState)
+    {
+      case '0':
+        tallySetOff();
+        break;
+      case '1':
+        tallySetProgram();
+        break;
+      case '2':
+        tallySetPreview();
+        break;
+      default:
+        tallySetOff();
+    }
+  }
 }
 
-// Hanle http server root request
-void rootPageHandler()
+// Handle any other response from vMix
+void handleResponse(const char *response)
 {
-  String response_message = "<!DOCTYPE html>";
-  response_message += "<html lang='en'>";
-  response_message += "<head>";
-  response_message += "<title>" + String(deviceName) + "</title>";
-  response_message += "<meta name='viewport' content='width=device-width, initial-scale=1, shrink-to-fit=no'>";
-  response_message += "<meta charset='utf-8'>";
-  response_message += "<link rel='icon' type='image/x-icon' href='favicon.ico'>";
-  response_message += "<link rel='stylesheet' href='styles.css'>";
-  response_message += "<style>body {width: 100%;height: 100%;padding: 25px;}</style>";
-  response_message += "</head>";
-
-  response_message += "<body class='bg-light'>";
-
-  response_message += "<h1>vMix tally " + String(settings.tallyNumber) + "</h1>";
-  response_message += "<div data-role='content' class='row'>";
-
-  response_message += "<div class='col-md-6'>";
-  response_message += "<h2>Settings</h2>";
-  response_message += "<form action='/save' method='post' enctype='multipart/form-data' data-ajax='false'>";
-
-  response_message += "<div class='form-group row'>";
-  response_message += "<label for='ssid' class='col-sm-4 col-form-label'>SSID</label>";
-  response_message += "<div class='col-sm-8'>";
-  response_message += "<input id='ssid' class='form-control' type='text' size='64' maxlength='64' name='ssid' value='" + String(settings.ssid) + "'>";
-  response_message += "</div></div>";
-
-  response_message += "<div class='form-group row'>";
-  response_message += "<label for='ssidpass' class='col-sm-4 col-form-label'>SSID password</label>";
-  response_message += "<div class='col-sm-8'>";
-  response_message += "<input id='ssidpass' class='form-control' type='text' size='64' maxlength='64' name='ssidpass' value='" + String(settings.pass) + "'>";
-  response_message += "</div></div>";
-
-  response_message += "<div class='form-group row'>";
-  response_message += "<label for='hostname' class='col-sm-4 col-form-label'>vMix hostname</label>";
-  response_message += "<div class='col-sm-8'>";
-  response_message += "<input id='hostname' class='form-control' type='text' size='64' maxlength='64' name='hostname' value='" + String(settings.hostName) + "'>";
-  response_message += "</div></div>";
-
-  response_message += "<div class='form-group row'>";
-  response_message += "<label for='inputnumber' class='col-sm-4 col-form-label'>Input number (1-1000)</label>";
-  response_message += "<div class='col-sm-8'>";
-  response_message += "<input id='inputnumber' class='form-control' type='number' size='64' min='0' max='1000' name='inputnumber' value='" + String(settings.tallyNumber) + "'>";
-  response_message += "</div></div>";
-
-  response_message += "<input type='submit' value='SAVE' class='btn btn-primary'></form>";
-  response_message += "</div>";
-
-  response_message += "<div class='col-md-6'>";
-  response_message += "<h2>Device information</h2>";
-  response_message += "<table class='table'><tbody>";
-
-  char ip[13];
-  sprintf(ip, "%d.%d.%d.%d", WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
-  response_message += "<tr><th>IP</th><td>" + String(ip) + "</td></tr>";
-
-  response_message += "<tr><th>MAC</th><td>" + String(WiFi.macAddress()) + "</td></tr>";
-  response_message += "<tr><th>Signal Strength</th><td>" + String(WiFi.RSSI()) + " dBm</td></tr>";
-  response_message += "<tr><th>Device Name</th><td>" + String(deviceName) + "</td></tr>";
-
-  if (WiFi.status() == WL_CONNECTED)
-  {
-    response_message += "<tr><th>Status</th><td>Connected</td></tr>";
-  }
-  else
+  Serial.print("Response from vMix: ");
+  Serial.println(response);
+}
+
+// Log vMix connection state changes, the followed host is selected by selectHost()
+void logConnection(VmixConnection::State state, const char *hostName)
+{
+  switch (state)
   {
-    response_message += "<tr><th>Status</th><td>Disconnected</td></tr>";
+    case VmixConnection::StateResolve:
+      Serial.print("Connecting to vMix on ");
+      Serial.print(hostName);
+      Serial.println("...");
+      break;
+    case VmixConnection::StateSubscribed:
+      bootStage(BootVmixConnected);
+      Serial.print("Connected to ");
+      Serial.println(hostName);
+      Serial.println("------------");
+      break;
+    case VmixConnection::StateDraining:
+      Serial.print("Connection to vMix lost on ");
+      Serial.println(hostName);
+      break;
+    case VmixConnection::StateBackoff:
+      Serial.print("Not connected to ");
+      Serial.print(hostName);
+      Serial.println(", retrying");
+      break;
+    default:
+      break;
   }
+}
 
-  if (apEnabled)
+// Handle primary vMix host connection state changes
+void handleConnection(VmixConnection::State state)
+{
+  if (state == VmixConnection::StateSubscribed)
   {
-    sprintf(ip, "%d.%d.%d.%d", WiFi.softAPIP()[0], WiFi.softAPIP()[1], WiFi.softAPIP()[2], WiFi.softAPIP()[3]);
-    response_message += "<tr><th>AP</th><td>Active (" + String(ip) + ")</td></tr>";
+    primaryState = -1;
   }
-  else
+  else if (state == VmixConnection::StateDraining && following == &vmix)
   {
-    response_message += "<tr><th>AP</th><td>Inactive</td></tr>";
+    lostHost = &vmix;
+    lostAt = vmix.lostAt;
   }
-  response_message += "</tbody></table>";
-  response_message += "</div>";
-  response_message += "</div>";
-
-  response_message += "</body>";
-  response_message += "</html>";
 
-  httpServer.sendHeader("Connection", "close");
-  httpServer.send(200, "text/html", String(response_message));
+  logConnection(state, settings.hostName);
+  sendConnectionEvent();
 }
 
-// Settings POST handler
-void handleSave()
+// Handle backup vMix host connection state changes
+void handleBackupConnection(VmixConnection::State state)
 {
-  bool doRestart = false;
+  if (state == VmixConnection::StateSubscribed)
+  {
+    backupState = -1;
+  }
+  else if (state == VmixConnection::StateDraining && following == &vmixBackup)
+  {
+    lostHost = &vmixBackup;
+    lostAt = vmixBackup.lostAt;
+  }
 
-  httpServer.sendHeader("Location", String("/"), true);
-  httpServer.send(302, "text/plain", "Redirected to: /");
+  logConnection(state, settings.backupHostName);
+  sendConnectionEvent();
+}
 
-  if (httpServer.hasArg("ssid"))
+// The host to follow according to the host policy, NULL when neither is connected.
+// A host is only followed once it reported a state, so switching to it never blanks the tally.
+VmixConnection *chooseHost()
+{
+  bool primary = vmix.connected() && primaryState >= 0;
+  bool backup = vmixBackup.connected() && backupState >= 0;
+
+  if (!primary || !backup)
   {
-    if (httpServer.arg("ssid").length() <= SsidMaxLength)
-    {
-      httpServer.arg("ssid").toCharArray(settings.ssid, SsidMaxLength);
-      doRestart = true;
-    }
+    return primary ? &vmix : backup ? &vmixBackup : NULL;
   }
 
-  if (httpServer.hasArg("ssidpass"))
+  switch (settings.hostPolicy)
   {
-    if (httpServer.arg("ssidpass").length() <= PassMaxLength)
-    {
-      httpServer.arg("ssidpass").toCharArray(settings.pass, PassMaxLength);
-      doRestart = true;
-    }
+    case HostPolicyRace:
+      // Stay with the host that connected first
+      if (following != NULL)
+      {
+        return following;
+      }
+      return (long)(vmixBackup.connectedAt - vmix.connectedAt) < 0 ? &vmixBackup : &vmix;
+    case HostPolicyLive:
+      // Follow the host that sent tally data last, there is nothing to switch for while both agree
+      if (following != NULL && primaryState == backupState)
+      {
+        return following;
+      }
+      return (long)(vmixBackup.messageAt - vmix.messageAt) > 0 ? &vmixBackup : &vmix;
+    default:
+      return &vmix;
   }
+}
 
-  if (httpServer.hasArg("hostname"))
+// Switch to another host when the followed one is lost or the policy prefers another
+void selectHost()
+{
+  VmixConnection *selected = chooseHost();
+
+  if (selected == following)
   {
-    if (httpServer.arg("hostname").length() <= HostNameMaxLength)
-    {
-      httpServer.arg("hostname").toCharArray(settings.hostName, HostNameMaxLength);
-      doRestart = true;
-    }
+    return;
   }
 
-  if (httpServer.hasArg("inputnumber"))
+  following = selected;
+
+  Serial.print("Following ");
+  Serial.println(following == &vmix ? settings.hostName : following == &vmixBackup ? settings.backupHostName : "no vMix host");
+
+  if (following == NULL)
   {
-    if (httpServer.arg("inputnumber").toInt() > 0 and httpServer.arg("inputnumber").toInt() <= TallyNumberMaxValue)
+    tallySetConnecting();
+  }
+  else
+  {
+    // Only a state that differs from the one shown counts as a change
+    showTally(following == &vmix ? primaryState : backupState, following->receivedCycles);
+    switchovers++;
+
+    // Measured until the LED shows the new host, it may show the same state already
+    if (lostHost != NULL && lostHost != following)
     {
-      settings.tallyNumber = httpServer.arg("inputnumber").toInt();
-      doRestart = true;
+      if (latencyPending)
+      {
+        switchoverPending = true;
+      }
+      else
+      {
+        switchoverTime.record(micros() - lostAt);
+      }
     }
-  }
 
-  if (doRestart == true)
-  {
-    restart();
+    lostHost = NULL;
   }
+
+  sendConnectionEvent();
 }
 
-// Connect to WiFi
-void connectToWifi()
+// Push the tally state to browsers
+void sendTallyEvent()
 {
-  Serial.println();
-  Serial.println("------------");
-  Serial.println("Connecting to WiFi");
-  Serial.print("SSID: ");
-  Serial.println(settings.ssid);
-  Serial.print("Passphrase: ");
-  Serial.println(settings.pass);
+  char data[32];
 
-  int timeout = 15;
+  snprintf(data, sizeof(data), "{\"state\":%d}", currentState >= '0' ? currentState - '0' : -1);
+  events.send("tally", data);
+}
 
-  WiFi.mode(WIFI_STA);
-  WiFi.hostname(deviceName);
-  WiFi.begin(settings.ssid, settings.pass);
+// Push the inputs whose tally changed to browsers
+void sendInputsEvent()
+{
+  const uint16_t *inputs;
+  int count = following != NULL ? following->parser.takeChanges(inputs) : 0;
 
-  Serial.print("Waiting for connection.");
-  while (WiFi.status() != WL_CONNECTED and timeout > 0)
+  if (count == 0)
   {
-    delay(1000);
-    timeout--;
-    Serial.print(".");
+    return;
   }
 
-  if (WiFi.status() == WL_CONNECTED)
+  char data[EventMaxLength];
+  int length = snprintf(data, sizeof(data), "{\"count\":%d,\"inputs\":[", count);
+
+  for (int i = 0; i < count && i < TallyChangesMaxValue; i++)
   {
-    Serial.println("Success!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
+    length += snprintf(data + length, sizeof(data) - length, i ? ",%u" : "%u", inputs[i]);
+  }
+
+  snprintf(data + length, sizeof(data) - length, "]}");
+  events.send("inputs", data);
+}
+
+// Push the WiFi and vMix connection state to browsers
+void sendConnectionEvent()
+{
+  static const char *stateNames[] = {"idle", "resolve", "connecting", "subscribed", "draining", "backoff"};
+  char data[96];
+
+  snprintf(data, sizeof(data), "{\"wifiConnected\":%s,\"vmix\":\"%s\",\"backup\":\"%s\",\"following\":\"%s\"}",
+           WiFi.status() == WL_CONNECTED ? "true" : "false", stateNames[vmix.state], stateNames[vmixBackup.state],
+           following == &vmix ? "primary" : following == &vmixBackup ? "backup" : "none");
+  events.send("connection", data);
+}
+
+// Push a WiFi signal strength sample to browsers
+void sendRssiEvent()
+{
+  char data[32];
+
+  snprintf(data, sizeof(data), "{\"rssi\":%d}", WiFi.RSSI());
+  events.send("rssi", data);
+}
+
+// Handle http server events request, the connection stays open as an event stream
+void eventsHandler()
+{
+  WiFiClient client = httpServer.client();
+
+  if (!events.subscribe(client))
+  {
+    httpServer.send(503, "text/plain", "Too many event subscribers");
+    return;
+  }
+
+  // Start every new subscriber with the current state
+  sendTallyEvent();
+  sendConnectionEvent();
+  sendRssiEvent();
+}
+
+// Convert a cycle counter difference to microseconds
+uint32_t cyclesToMicros(uint32_t cycles)
+{
+  return cycles / ESP.getCpuFreqMHz();
+}
+
+// Record the time until the LED shows the last tally state
+void handleLatch()
+{
+  uint32_t latched = ESP.getCycleCount();
+
+  latencyDisplay.record(cyclesToMicros(latched - latencyDecided));
+  latencyTotal.record(cyclesToMicros(latched - latencyReceived));
+  latencyPending = false;
+
+  if (switchoverPending)
+  {
+    switchoverTime.record(micros() - lostAt);
+    switchoverPending = false;
+  }
+}
+
+// Print one latency histogram line into buffer
+int printHistogram(char *buffer, size_t size, const char *name, const LatencyHistogram &histogram)
+{
+  return snprintf(buffer, size, "%-16s %8u %8u %8u %8u %8u %8u\n", name, histogram.count, histogram.min,
+                  histogram.percentile(50), histogram.percentile(90), histogram.percentile(99), histogram.max);
+}
+
+// Print all latency histograms into buffer
+void printLatency(char *buffer, size_t size)
+{
+  int length = snprintf(buffer, size, "%-16s %8s %8s %8s %8s %8s %8s\n", "Latency (us)", "count", "min", "p50", "p90", "p99", "max");
+  length += printHistogram(buffer + length, size - length, "Receive-decide", latencyDecide);
+  length += printHistogram(buffer + length, size - length, "Decide-latch", latencyDisplay);
+  printHistogram(buffer + length, size - length, "Receive-latch", latencyTotal);
+}
+
+// Handle http server latency request
+void latencyHandler()
+{
+  char buffer[384];
+
+  if (httpServer.hasArg("reset"))
+  {
+    latencyDecide.reset();
+    latencyDisplay.reset();
+    latencyTotal.reset();
+  }
+
+  printLatency(buffer, sizeof(buffer));
+  httpServer.send(200, "text/plain", buffer);
+}
+
+// Start a chunked HTTP response
+void chunkBegin(int code, const char *contentType)
+{
+  httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  httpServer.send(code, contentType, "");
+  chunkLength = 0;
+}
+
+// Send what is in the chunk buffer
+void chunkFlush()
+{
+  if (chunkLength > 0)
+  {
+    httpServer.sendContent_P(chunkBuffer, chunkLength);
+    chunkLength = 0;
+  }
+}
+
+// Append one character to the chunked response
+void chunkPut(char c)
+{
+  if (chunkLength == sizeof(chunkBuffer))
+  {
+    chunkFlush();
+  }
+
+  chunkBuffer[chunkLength++] = c;
+}
+
+// Append formatted text to the chunked response
+void chunkPrintf(const char *format, ...)
+{
+  va_list args;
+  size_t space = sizeof(chunkBuffer) - chunkLength;
+
+  va_start(args, format);
+  int length = vsnprintf(chunkBuffer + chunkLength, space, format, args);
+  va_end(args);
+
+  // Did not fit, send what we have and format again into the empty buffer
+  if (length >= (int)space)
+  {
+    chunkFlush();
+
+    va_start(args, format);
+    length = vsnprintf(chunkBuffer, sizeof(chunkBuffer), format, args);
+    va_end(args);
+
+    if (length >= (int)sizeof(chunkBuffer))
+    {
+      length = sizeof(chunkBuffer) - 1;
+    }
+  }
+
+  chunkLength += length;
+}
+
+// Finish the chunked response
+void chunkEnd()
+{
+  chunkFlush();
+  httpServer.sendContent("");
+}
+
+// Append one metric in the Prometheus text format
+void printMetric(const char *name, const char *type, const char *help, long value)
+{
+  chunkPrintf("# HELP %s %s\n# TYPE %s %s\n%s %ld\n", name, help, name, type, name, value);
+}
+
+// Append one value of a scheduled task, labelled with the task name
+void printTaskValue(const char *name, const char *task, unsigned long long value)
+{
+  chunkPrintf("%s{task=\"%s\"} %llu\n", name, task, value);
+}
+
+// Append the runtime statistics of the scheduled tasks
+void printTaskMetrics()
+{
+  const char *runs = "vmix_tally_task_runs_total";
+  const char *runtime = "vmix_tally_task_runtime_microseconds_total";
+  const char *maxRuntime = "vmix_tally_task_max_runtime_microseconds";
+  const char *misses = "vmix_tally_task_deadline_misses_total";
+  const char *deferred = "vmix_tally_task_deferred_total";
+
+  chunkPrintf("# HELP %s Scheduled task runs\n# TYPE %s counter\n", runs, runs);
+  for (int i = 0; i < scheduler.taskCount; i++)
+    printTaskValue(runs, scheduler.tasks[i].name, scheduler.tasks[i].runs);
+
+  chunkPrintf("# HELP %s Time spent in scheduled tasks\n# TYPE %s counter\n", runtime, runtime);
+  for (int i = 0; i < scheduler.taskCount; i++)
+    printTaskValue(runtime, scheduler.tasks[i].name, scheduler.tasks[i].runtime);
+
+  chunkPrintf("# HELP %s Longest run of scheduled tasks\n# TYPE %s gauge\n", maxRuntime, maxRuntime);
+  for (int i = 0; i < scheduler.taskCount; i++)
+    printTaskValue(maxRuntime, scheduler.tasks[i].name, scheduler.tasks[i].maxRuntime);
+
+  chunkPrintf("# HELP %s Scheduled task runs over their budget\n# TYPE %s counter\n", misses, misses);
+  for (int i = 0; i < scheduler.taskCount; i++)
+    printTaskValue(misses, scheduler.tasks[i].name, scheduler.tasks[i].misses);
+
+  chunkPrintf("# HELP %s Scheduled task runs deferred to a later loop\n# TYPE %s counter\n", deferred, deferred);
+  for (int i = 0; i < scheduler.taskCount; i++)
+    printTaskValue(deferred, scheduler.tasks[i].name, scheduler.tasks[i].deferred);
+}
+
+// Append a latency histogram as a Prometheus summary
+void printSummary(const char *name, const char *help, const LatencyHistogram &histogram)
+{
+  chunkPrintf("# HELP %s %s\n# TYPE %s summary\n"
+              "%s{quantile=\"0.5\"} %u\n%s{quantile=\"0.9\"} %u\n%s{quantile=\"0.99\"} %u\n"
+              "%s_sum %llu\n%s_count %u\n",
+              name, help, name,
+              name, histogram.percentile(50), name, histogram.percentile(90), name, histogram.percentile(99),
+              name, (unsigned long long)histogram.sum, name, histogram.count);
+}
+
+// Handle http server metrics request
+void metricsHandler()
+{
+  chunkBegin(200, "text/plain; version=0.0.4");
+
+  printMetric("vmix_tally_messages_total", "counter", "TALLY messages parsed", vmix.parser.messages);
+  printMetric("vmix_tally_activators_total", "counter", "ACTS events parsed", vmix.parser.activators);
+  printMetric("vmix_tally_coalesced_total", "counter", "Tally states superseded within a burst", vmix.coalesced);
+  printMetric("vmix_tally_state_changes_total", "counter", "Tally state changes shown", stateChanges);
+  printMetric("vmix_tally_state", "gauge", "Current tally state, 0 off 1 program 2 preview", currentState >= '0' ? currentState - '0' : -1);
+  printMetric("vmix_tally_connect_attempts_total", "counter", "Connection attempts to vMix", vmix.attempts);
+  printMetric("vmix_tally_reconnects_total", "counter", "Connections to vMix lost", vmix.reconnects);
+  printMetric("vmix_tally_heartbeats_missed_total", "counter", "Heartbeats vMix did not reply to in time", vmix.heartbeatsMissed);
+  printMetric("vmix_tally_heartbeat_timeouts_total", "counter", "Connections to vMix dropped for missed heartbeats", vmix.heartbeatTimeouts);
+  printMetric("vmix_tally_connected", "gauge", "Subscribed to vMix", vmix.connected());
+  printMetric("vmix_tally_backup_connected", "gauge", "Subscribed to the backup vMix host", vmixBackup.connected());
+  printMetric("vmix_tally_backup_reconnects_total", "counter", "Connections to the backup vMix host lost", vmixBackup.reconnects);
+  printMetric("vmix_tally_following", "gauge", "Followed vMix host, 0 primary 1 backup -1 none", following == &vmix ? 0 : following == &vmixBackup ? 1 : -1);
+  printMetric("vmix_tally_switchovers_total", "counter", "Changes of the followed vMix host", switchovers);
+  printMetric("vmix_tally_connect_duration_milliseconds", "gauge", "Time the last successful connection took", vmix.connectDuration);
+  printMetric("vmix_tally_connected_seconds", "gauge", "Time since the connection to vMix was made", vmix.connected() ? (millis() - vmix.connectedAt) / 1000 : 0);
+  printMetric("vmix_tally_led_rows_sent_total", "counter", "LED rows sent to the display", matrix.rowsSent);
+  printMetric("vmix_tally_led_rows_skipped_total", "counter", "LED rows skipped because they did not change", matrix.rowsSkipped);
+  printMetric("vmix_tally_event_subscribers", "gauge", "Browsers subscribed to /events", events.subscribers());
+  printMetric("vmix_tally_events_sent_total", "counter", "Events pushed to browsers", events.sent);
+  printMetric("vmix_tally_event_subscribers_dropped_total", "counter", "Event subscribers dropped because they fell behind", events.dropped);
+  printMetric("vmix_tally_free_heap_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+  printMetric("vmix_tally_max_free_block_bytes", "gauge", "Largest free heap block", ESP.getMaxFreeBlockSize());
+  printMetric("vmix_tally_wifi_rssi_dbm", "gauge", "WiFi signal strength", WiFi.RSSI());
+  printMetric("vmix_tally_uptime_seconds", "counter", "Time since boot", millis() / 1000);
+  printSummary("vmix_tally_loop_microseconds", "Time per loop iteration", loopTime);
+  printSummary("vmix_tally_heartbeat_round_trip_microseconds", "VERSION command to reply", vmix.roundTrip);
+  printSummary("vmix_tally_backup_heartbeat_round_trip_microseconds", "VERSION command to reply on the backup host", vmixBackup.roundTrip);
+  printSummary("vmix_tally_switchover_microseconds", "Followed vMix host lost to tally shown from another host", switchoverTime);
+  printMetric("vmix_tally_loop_budget_misses_total", "counter", "Loop iterations over the frame budget", scheduler.frameMisses);
+  printTaskMetrics();
+  printSummary("vmix_tally_receive_decide_microseconds", "Socket read to tally state decided", latencyDecide);
+  printSummary("vmix_tally_decide_latch_microseconds", "Tally state decided to LED latched", latencyDisplay);
+  printSummary("vmix_tally_receive_latch_microseconds", "Socket read to LED latched", latencyTotal);
+
+  chunkEnd();
+}
+
+// Print the runtime of every scheduled task
+void printTasks()
+{
+  Serial.printf("%-10s %10s %10s %10s %10s %10s %10s\n", "task", "budget", "runs", "avg us", "max us", "misses", "deferred");
+
+  for (int i = 0; i < scheduler.taskCount; i++)
+  {
+    const Scheduler::Task &task = scheduler.tasks[i];
+
+    Serial.printf("%-10s %10u %10lu %10lu %10u %10lu %10lu\n", task.name, task.budget, task.runs,
+                  task.runs ? (unsigned long)(task.runtime / task.runs) : 0, task.maxRuntime, task.misses, task.deferred);
+  }
+
+  Serial.printf("%lu of %lu loops over the %u us budget\n", scheduler.frameMisses, scheduler.frames, scheduler.frameBudget);
+}
+
+// Handle serial commands, l prints the latency histograms and t the task runtimes
+void handleSerial()
+{
+  char command = Serial.read();
+
+  if (command == 'l')
+  {
+    char buffer[384];
+
+    printLatency(buffer, sizeof(buffer));
+    Serial.print(buffer);
+  }
+  else if (command == 't')
+  {
+    printTasks();
+  }
+}
+
+// Start access point
+void apStart()
+{
+  ledSetSettings();
+  Serial.println("AP Start");
+  Serial.print("AP SSID: ");
+  Serial.println(deviceName);
+  Serial.print("AP password: ");
+  Serial.println(apPass);
+
+  WiFi.mode(WIFI_AP);
+  WiFi.hostname(deviceName);
+  WiFi.softAP(deviceName, apPass);
+  delay(100);
+  IPAddress myIP = WiFi.softAPIP();
+  Serial.print("IP address: ");
+  Serial.println(myIP);
+
+  apEnabled = true;
+}
+
+// Root page, {{NAME}} placeholders are filled in by printPlaceholder()
+static const char rootPageTemplate[] PROGMEM = R"(<!DOCTYPE html>
+<html lang='en'>
+<head>
+<title>{{DEVICE_NAME}}</title>
+<meta name='viewport' content='width=device-width, initial-scale=1, shrink-to-fit=no'>
+<meta charset='utf-8'>
+<link rel='icon' type='image/x-icon' href='favicon.ico'>
+<link rel='stylesheet' href='styles.css'>
+<style>body {width: 100%;height: 100%;padding: 25px;}</style>
+</head>
+<body class='bg-light'>
+<h1>vMix tally {{TALLY_NUMBER}}</h1>
+<div data-role='content' class='row'>
+<div class='col-md-6'>
+<h2>Settings</h2>
+<form action='/save' method='post' enctype='multipart/form-data' data-ajax='false'>
+<div class='form-group row'>
+<label for='ssid' class='col-sm-4 col-form-label'>SSID</label>
+<div class='col-sm-8'>
+<input id='ssid' class='form-control' type='text' size='64' maxlength='63' name='ssid' value='{{SSID}}'>
+</div></div>
+<div class='form-group row'>
+<label for='ssidpass' class='col-sm-4 col-form-label'>SSID password</label>
+<div class='col-sm-8'>
+<input id='ssidpass' class='form-control' type='text' size='64' maxlength='63' name='ssidpass' value='{{PASS}}'>
+</div></div>
+<div class='form-group row'>
+<label for='hostname' class='col-sm-4 col-form-label'>vMix hostname</label>
+<div class='col-sm-8'>
+<input id='hostname' class='form-control' type='text' size='64' maxlength='63' name='hostname' value='{{HOSTNAME}}'>
+</div></div>
+<div class='form-group row'>
+<label for='backuphostname' class='col-sm-4 col-form-label'>vMix backup hostname</label>
+<div class='col-sm-8'>
+<input id='backuphostname' class='form-control' type='text' size='64' maxlength='63' name='backuphostname' value='{{BACKUP_HOSTNAME}}'>
+</div></div>
+<div class='form-group row'>
+<label for='hostpolicy' class='col-sm-4 col-form-label'>Follow</label>
+<div class='col-sm-8'>
+<select id='hostpolicy' class='form-control' name='hostpolicy'>
+<option value='0'{{POLICY_PRIMARY}}>Primary, backup while the primary is down</option>
+<option value='1'{{POLICY_RACE}}>Whichever host connected first</option>
+<option value='2'{{POLICY_LIVE}}>Whichever host sent tally data last</option>
+</select>
+</div></div>
+<div class='form-group row'>
+<label for='inputnumber' class='col-sm-4 col-form-label'>Input number (1-1000)</label>
+<div class='col-sm-8'>
+<input id='inputnumber' class='form-control' type='number' size='64' min='0' max='1000' name='inputnumber' value='{{TALLY_NUMBER}}'>
+</div></div>
+<div class='form-group row'>
+<label for='extrainputs' class='col-sm-4 col-form-label'>Also follow inputs</label>
+<div class='col-sm-8'>
+<input id='extrainputs' class='form-control' type='text' size='64' maxlength='64' name='extrainputs' value='{{EXTRA_INPUTS}}' placeholder='e.g. 3,7,12'>
+</div></div>
+<div class='form-group row'>
+<label for='overlays' class='col-sm-4 col-form-label'>Overlay channels (ACTS)</label>
+<div class='col-sm-8'>
+<input id='overlays' class='form-control' type='text' size='64' maxlength='64' name='overlays' value='{{OVERLAYS}}' placeholder='e.g. 1,2,3,4'>
+</div></div>
+<div class='form-group row'>
+<label for='heartbeat' class='col-sm-4 col-form-label'>Missed heartbeats before reconnecting (0-10, 0 is off)</label>
+<div class='col-sm-8'>
+<input id='heartbeat' class='form-control' type='number' min='0' max='10' name='heartbeat' value='{{HEARTBEAT}}'>
+</div></div>
+<div class='form-group row'>
+<label for='tallymode' class='col-sm-4 col-form-label'>vMix events</label>
+<div class='col-sm-8'>
+<select id='tallymode' class='form-control' name='tallymode'>
+<option value='0'{{MODE_TALLY}}>TALLY, all inputs on every change</option>
+<option value='1'{{MODE_ACTS}}>ACTS, only changes of this input</option>
+</select>
+</div></div>
+<input type='submit' value='SAVE' class='btn btn-primary'></form>
+</div>
+<div class='col-md-6'>
+<h2>Device information</h2>
+<table class='table'><tbody>
+<tr><th>IP</th><td>{{IP}}</td></tr>
+<tr><th>MAC</th><td>{{MAC}}</td></tr>
+<tr><th>Signal Strength</th><td>{{RSSI}} dBm</td></tr>
+<tr><th>Device Name</th><td>{{DEVICE_NAME}}</td></tr>
+<tr><th>Tally messages/coalesced</th><td>{{MESSAGES}}</td></tr>
+<tr><th>LED rows sent/skipped</th><td>{{LED_ROWS}}</td></tr>
+<tr><th>Status</th><td>{{STATUS}}</td></tr>
+<tr><th>AP</th><td>{{AP}}</td></tr>
+</tbody></table>
+</div>
+</div>
+</body>
+</html>
+)";
+
+// Append text to the chunked response with HTML special characters escaped
+void chunkPrintEscaped(const char *text)
+{
+  for (; *text; text++)
+  {
+    switch (*text)
+    {
+      case '&':
+        chunkPrintf("&amp;");
+        break;
+      case '<':
+        chunkPrintf("&lt;");
+        break;
+      case '>':
+        chunkPrintf("&gt;");
+        break;
+      case '\'':
+        chunkPrintf("&#39;");
+        break;
+      case '"':
+        chunkPrintf("&quot;");
+        break;
+      default:
+        chunkPut(*text);
+    }
+  }
+}
+
+// Append the value of a template placeholder to the chunked response
+void printPlaceholder(const char *name)
+{
+  if (strcmp(name, "DEVICE_NAME") == 0)
+  {
+    chunkPrintEscaped(deviceName);
+  }
+  else if (strcmp(name, "TALLY_NUMBER") == 0)
+  {
+    chunkPrintf("%d", settings.tallyNumber);
+  }
+  else if (strcmp(name, "EXTRA_INPUTS") == 0)
+  {
+    chunkPrintf("%s", formatInputs());
+  }
+  else if (strcmp(name, "OVERLAYS") == 0)
+  {
+    chunkPrintf("%s", formatOverlays());
+  }
+  else if (strcmp(name, "BACKUP_HOSTNAME") == 0)
+  {
+    chunkPrintEscaped(settings.backupHostName);
+  }
+  else if (strcmp(name, "POLICY_PRIMARY") == 0)
+  {
+    chunkPrintf("%s", settings.hostPolicy == HostPolicyPrimary ? " selected" : "");
+  }
+  else if (strcmp(name, "POLICY_RACE") == 0)
+  {
+    chunkPrintf("%s", settings.hostPolicy == HostPolicyRace ? " selected" : "");
+  }
+  else if (strcmp(name, "POLICY_LIVE") == 0)
+  {
+    chunkPrintf("%s", settings.hostPolicy == HostPolicyLive ? " selected" : "");
+  }
+  else if (strcmp(name, "HEARTBEAT") == 0)
+  {
+    chunkPrintf("%d", settings.heartbeatMisses);
+  }
+  else if (strcmp(name, "MODE_TALLY") == 0)
+  {
+    chunkPrintf("%s", settings.tallyMode == TallyModeTally ? " selected" : "");
+  }
+  else if (strcmp(name, "MODE_ACTS") == 0)
+  {
+    chunkPrintf("%s", settings.tallyMode == TallyModeActs ? " selected" : "");
+  }
+  else if (strcmp(name, "SSID") == 0)
+  {
+    chunkPrintEscaped(settings.ssid);
+  }
+  else if (strcmp(name, "PASS") == 0)
+  {
+    chunkPrintEscaped(settings.pass);
+  }
+  else if (strcmp(name, "HOSTNAME") == 0)
+  {
+    chunkPrintEscaped(settings.hostName);
+  }
+  else if (strcmp(name, "IP") == 0)
+  {
+    IPAddress ip = WiFi.localIP();
+    chunkPrintf("%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+  }
+  else if (strcmp(name, "MAC") == 0)
+  {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    chunkPrintf("%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  }
+  else if (strcmp(name, "RSSI") == 0)
+  {
+    chunkPrintf("%d", WiFi.RSSI());
+  }
+  else if (strcmp(name, "MESSAGES") == 0)
+  {
+    chunkPrintf("%lu / %lu", vmix.parser.messages, vmix.coalesced);
+  }
+  else if (strcmp(name, "LED_ROWS") == 0)
+  {
+    chunkPrintf("%lu / %lu", matrix.rowsSent, matrix.rowsSkipped);
+  }
+  else if (strcmp(name, "STATUS") == 0)
+  {
+    chunkPrintf("%s", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected");
+  }
+  else if (strcmp(name, "AP") == 0)
+  {
+    if (apEnabled)
+    {
+      IPAddress ip = WiFi.softAPIP();
+      chunkPrintf("Active (%d.%d.%d.%d)", ip[0], ip[1], ip[2], ip[3]);
+    }
+    else
+    {
+      chunkPrintf("Inactive");
+    }
+  }
+}
+
+// Stream a PROGMEM template as a chunked response, filling in the placeholders
+void chunkTemplate(PGM_P page)
+{
+  char name[16];
+  char c;
+
+  while ((c = pgm_read_byte(page++)) != '\0')
+  {
+    if (c == '{' && pgm_read_byte(page) == '{')
+    {
+      int length = 0;
+      page++;
+
+      while ((c = pgm_read_byte(page)) != '\0' && c != '}')
+      {
+        if (length < (int)sizeof(name) - 1)
+        {
+          name[length++] = c;
+        }
+        page++;
+      }
+
+      // Skip the closing braces
+      while (pgm_read_byte(page) == '}')
+      {
+        page++;
+      }
+
+      name[length] = '\0';
+      printPlaceholder(name);
+      continue;
+    }
+
+    chunkPut(c);
+  }
+}
+
+// Entity tag of the uploaded page, SPIFFS only changes with a new upload and restart
+String pageTag()
+{
+  static String tag;
+
+  if (tag.length() == 0)
+  {
+    File file = SPIFFS.open("/index.htm.gz", "r");
+    uint8_t buffer[64];
+    uint32_t crc = 0xFFFFFFFF;
+    int length;
+
+    while ((length = file.read(buffer, sizeof(buffer))) > 0)
+    {
+      crc = crcUpdate(crc, buffer, length);
+    }
+
+    file.close();
+    tag = "\"" + String(~crc, HEX) + "\"";
+  }
+
+  return tag;
+}
+
+// Hanle http server root request
+void rootPageHandler()
+{
+  // Serve the static page when it was uploaded, it gets its data from the API.
+  // It keeps its name across uploads so it is revalidated instead of cached for years
+  if (SPIFFS.exists("/index.htm.gz"))
+  {
+    String tag = pageTag();
+
+    httpServer.sendHeader("Cache-Control", "no-cache");
+    httpServer.sendHeader("ETag", tag);
+
+    if (httpServer.header("If-None-Match") == tag)
+    {
+      httpServer.send(304, "text/html", "");
+      return;
+    }
+
+    File file = SPIFFS.open("/index.htm.gz", "r");
+    httpServer.streamFile(file, "text/html");
+    file.close();
+    return;
+  }
+
+  httpServer.sendHeader("Connection", "close");
+  chunkBegin(200, "text/html");
+  chunkTemplate(rootPageTemplate);
+  chunkEnd();
+}
+
+// Read the posted settings, they are only applied when every field is valid
+bool readSettingsArgs()
+{
+  Settings updated = settings;
+  bool posted = false;
+  bool valid = true;
+
+  if (httpServer.hasArg("ssid"))
+  {
+    posted = true;
+
+    if (httpServer.arg("ssid").length() < SsidMaxLength)
+    {
+      httpServer.arg("ssid").toCharArray(updated.ssid, SsidMaxLength);
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("ssidpass"))
+  {
+    posted = true;
+
+    if (httpServer.arg("ssidpass").length() < PassMaxLength)
+    {
+      httpServer.arg("ssidpass").toCharArray(updated.pass, PassMaxLength);
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("hostname"))
+  {
+    posted = true;
+
+    if (httpServer.arg("hostname").length() < HostNameMaxLength)
+    {
+      httpServer.arg("hostname").toCharArray(updated.hostName, HostNameMaxLength);
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("inputnumber"))
+  {
+    posted = true;
+
+    if (httpServer.arg("inputnumber").toInt() > 0 and httpServer.arg("inputnumber").toInt() <= TallyNumberMaxValue)
+    {
+      updated.tallyNumber = httpServer.arg("inputnumber").toInt();
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("backuphostname"))
+  {
+    posted = true;
+
+    if (httpServer.arg("backuphostname").length() < HostNameMaxLength)
+    {
+      httpServer.arg("backuphostname").toCharArray(updated.backupHostName, HostNameMaxLength);
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("hostpolicy"))
+  {
+    String hostPolicy = httpServer.arg("hostpolicy");
+    posted = true;
+
+    if (hostPolicy.length() > 0 && hostPolicy.toInt() >= HostPolicyPrimary && hostPolicy.toInt() <= HostPolicyLive)
+    {
+      updated.hostPolicy = hostPolicy.toInt();
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("extrainputs"))
+  {
+    uint16_t extraInputs[TallyInputsMaxValue - 1];
+    posted = true;
+
+    if (parseList(httpServer.arg("extrainputs").c_str(), TallyNumberMaxValue, extraInputs, TallyInputsMaxValue - 1))
+    {
+      memcpy(updated.extraInputs, extraInputs, sizeof(updated.extraInputs));
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("overlays"))
+  {
+    uint16_t channels[OverlayChannels];
+    posted = true;
+
+    if (parseList(httpServer.arg("overlays").c_str(), OverlayChannels, channels, OverlayChannels))
+    {
+      updated.overlayMask = 0;
+
+      for (int i = 0; i < OverlayChannels && channels[i] > 0; i++)
+      {
+        updated.overlayMask |= 1 << (channels[i] - 1);
+      }
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("heartbeat"))
+  {
+    String heartbeat = httpServer.arg("heartbeat");
+    posted = true;
+
+    if (heartbeat.length() > 0 && heartbeat.toInt() >= 0 && heartbeat.toInt() <= HeartbeatMissesMaxValue)
+    {
+      updated.heartbeatMisses = heartbeat.toInt();
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (httpServer.hasArg("tallymode"))
+  {
+    posted = true;
+
+    if (httpServer.arg("tallymode").toInt() == TallyModeTally || httpServer.arg("tallymode").toInt() == TallyModeActs)
+    {
+      updated.tallyMode = httpServer.arg("tallymode").toInt();
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (!posted || !valid)
+  {
+    return false;
+  }
+
+  settings = updated;
+  return true;
+}
+
+// Settings POST handler
+void handleSave()
+{
+  Settings previous = settings;
+
+  if (!readSettingsArgs())
+  {
+    httpServer.send(400, "text/plain", "Invalid settings, nothing was saved");
+    return;
+  }
+
+  httpServer.sendHeader("Location", String("/"), true);
+  httpServer.send(302, "text/plain", "Redirected to: /");
+  applySettings(previous);
+}
+
+// Append a JSON string to the chunked response
+void chunkPrintJson(const char *text)
+{
+  chunkPut('"');
+
+  for (; *text; text++)
+  {
+    if (*text == '"' || *text == '\\')
+    {
+      chunkPut('\\');
+      chunkPut(*text);
+    }
+    else if ((uint8_t)*text < 0x20)
+    {
+      chunkPrintf("\\u%04x", *text);
+    }
+    else
+    {
+      chunkPut(*text);
+    }
+  }
+
+  chunkPut('"');
+}
+
+// Handle http server status API request
+void apiStatusHandler()
+{
+  IPAddress ip = WiFi.localIP();
+  IPAddress apIp = WiFi.softAPIP();
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+
+  chunkBegin(200, "application/json");
+  chunkPrintf("{\"deviceName\":");
+  chunkPrintJson(deviceName);
+  chunkPrintf(",\"tallyNumber\":%d,\"state\":%d", settings.tallyNumber, currentState >= '0' ? currentState - '0' : -1);
+  chunkPrintf(",\"ip\":\"%d.%d.%d.%d\"", ip[0], ip[1], ip[2], ip[3]);
+  chunkPrintf(",\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\"", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  chunkPrintf(",\"rssi\":%d,\"wifiConnected\":%s,\"vmixConnected\":%s", WiFi.RSSI(), WiFi.status() == WL_CONNECTED ? "true" : "false", vmix.connected() ? "true" : "false");
+  chunkPrintf(",\"apEnabled\":%s,\"apIp\":\"%d.%d.%d.%d\"", apEnabled ? "true" : "false", apIp[0], apIp[1], apIp[2], apIp[3]);
+  chunkPrintf(",\"messages\":%lu,\"activators\":%lu,\"coalesced\":%lu", vmix.parser.messages, vmix.parser.activators, vmix.coalesced);
+  chunkPrintf(",\"roundTrip\":%u,\"heartbeatTimeouts\":%lu", vmix.lastRoundTrip, vmix.heartbeatTimeouts);
+  chunkPrintf(",\"backupConnected\":%s,\"following\":\"%s\",\"switchovers\":%lu", vmixBackup.connected() ? "true" : "false",
+              following == &vmix ? "primary" : following == &vmixBackup ? "backup" : "none", switchovers);
+  chunkPrintf(",\"ledRowsSent\":%lu,\"ledRowsSkipped\":%lu", matrix.rowsSent, matrix.rowsSkipped);
+  chunkPrintf(",\"uptime\":%lu,\"freeHeap\":%u}", millis() / 1000, ESP.getFreeHeap());
+  chunkEnd();
+}
+
+// Handle http server settings API request
+void apiSettingsHandler()
+{
+  chunkBegin(200, "application/json");
+  chunkPrintf("{\"ssid\":");
+  chunkPrintJson(settings.ssid);
+  chunkPrintf(",\"pass\":");
+  chunkPrintJson(settings.pass);
+  chunkPrintf(",\"hostName\":");
+  chunkPrintJson(settings.hostName);
+  chunkPrintf(",\"tallyNumber\":%d,\"tallyNumberMax\":%d,\"tallyMode\":%d", settings.tallyNumber, TallyNumberMaxValue, settings.tallyMode);
+  chunkPrintf(",\"extraInputs\":\"%s\",\"overlays\":\"%s\"", formatInputs(), formatOverlays());
+  chunkPrintf(",\"heartbeatMisses\":%d,\"heartbeatMissesMax\":%d", settings.heartbeatMisses, HeartbeatMissesMaxValue);
+  chunkPrintf(",\"backupHostName\":");
+  chunkPrintJson(settings.backupHostName);
+  chunkPrintf(",\"hostPolicy\":%d}", settings.hostPolicy);
+  chunkEnd();
+}
+
+// Settings API POST handler, takes the same fields as /save
+void apiSaveHandler()
+{
+  Settings previous = settings;
+
+  if (readSettingsArgs())
+  {
+    httpServer.send(200, "application/json", "{\"saved\":true}");
+    applySettings(previous);
+  }
+  else
+  {
+    httpServer.send(400, "application/json", "{\"saved\":false}");
+  }
+}
+
+// Connect to WiFi
+void connectToWifi()
+{
+  Serial.println();
+  Serial.println("------------");
+  Serial.println("Connecting to WiFi");
+  Serial.print("SSID: ");
+  Serial.println(settings.ssid);
+  Serial.print("Passphrase: ");
+  Serial.println(settings.pass);
+
+  // Station mode turns the access point off
+  vmix.stop();
+  vmixBackup.stop();
+  following = NULL;
+  lostHost = NULL;
+  switchoverPending = false;
+  apEnabled = false;
+
+  WiFi.mode(WIFI_STA);
+  WiFi.hostname(deviceName);
+
+  // Join the last known access point directly, without a scan
+  wifiFast = wifiCache.magic == WifiCacheMagic;
+  WiFi.config(0U, 0U, 0U);
+
+  if (wifiFast)
+  {
+    Serial.println("Using cached BSSID and channel");
+    WiFi.begin(settings.ssid, settings.pass, wifiCache.channel, wifiCache.bssid);
+  }
+  else
+  {
+    WiFi.begin(settings.ssid, settings.pass);
+  }
+
+  bootStage(BootWifiBegin);
+  Serial.println("Waiting for connection...");
+  wifiConnecting = true;
+  wifiStart = millis();
+}
+
+// Check the WiFi association started by connectToWifi(), called from loop()
+void checkWifi()
+{
+  wl_status_t wifiStatus = WiFi.status();
+
+  if (wifiStatus == WL_CONNECTED)
+  {
+    wifiConnecting = false;
+    bootStage(BootWifiConnected);
+
+    Serial.print("Success after ");
+    Serial.print(millis() - wifiStart);
+    Serial.print(" ms (");
+    Serial.print(millis());
+    Serial.println(" ms since boot)");
+    Serial.print("IP address: ");
+    Serial.println(WiFi.localIP());
     Serial.print("Device name: ");
     Serial.println(deviceName);
     Serial.println("------------");
+
+    saveWifiCache();
+    connectTovMix();
   }
-  else
+  else if (wifiFast && millis() - wifiStart >= WifiFastTimeout)
+  {
+    // Fall back to a full scan
+    Serial.println("Fast reconnect failed, scanning");
+    wifiFast = false;
+    wifiCache.magic = 0;
+
+    WiFi.disconnect();
+    WiFi.begin(settings.ssid, settings.pass);
+    wifiStart = millis();
+  }
+  else if (millis() - wifiStart >= WifiTimeout)
   {
-    if (WiFi.status() == WL_IDLE_STATUS)
+    wifiConnecting = false;
+
+    if (wifiStatus == WL_IDLE_STATUS)
       Serial.println("Idle");
-    else if (WiFi.status() == WL_NO_SSID_AVAIL)
+    else if (wifiStatus == WL_NO_SSID_AVAIL)
       Serial.println("No SSID Available");
-    else if (WiFi.status() == WL_SCAN_COMPLETED)
+    else if (wifiStatus == WL_SCAN_COMPLETED)
       Serial.println("Scan Completed");
-    else if (WiFi.status() == WL_CONNECT_FAILED)
+    else if (wifiStatus == WL_CONNECT_FAILED)
       Serial.println("Connection Failed");
-    else if (WiFi.status() == WL_CONNECTION_LOST)
+    else if (wifiStatus == WL_CONNECTION_LOST)
       Serial.println("Connection Lost");
-    else if (WiFi.status() == WL_DISCONNECTED)
+    else if (wifiStatus == WL_DISCONNECTED)
       Serial.println("Disconnected");
     else
       Serial.println("Unknown Failure");
@@ -504,44 +1821,94 @@ void connectToWifi()
   }
 }
 
-// Connect to vMix instance
+// Connect to the vMix instances
 void connectTovMix()
 {
-  Serial.print("Connecting to vMix on ");
-  Serial.print(settings.hostName);
-  Serial.print("...");
+  following = NULL;
+  lostHost = NULL;
+  switchoverPending = false;
 
-  if (client.connect(settings.hostName, port))
-  {
-    Serial.println(" Connected!");
-    Serial.println("------------");
-    
-    tallySetOff();
+  vmix.begin(settings.hostName, port);
+  connectToBackup();
+}
 
-    // Subscribe to the tally events
-    client.println("SUBSCRIBE TALLY");
+// Connect to the backup vMix instance, when there is one
+void connectToBackup()
+{
+  if (strlen(settings.backupHostName) > 0)
+  {
+    vmixBackup.begin(settings.backupHostName, port);
   }
   else
   {
-    Serial.println(" Not found!");
+    vmixBackup.stop();
   }
 }
 
-void restart()
+// Settings shared by the primary and backup connection
+void configureConnections()
+{
+  vmix.setActs(settings.tallyMode == TallyModeActs);
+  vmix.setHeartbeat(settings.heartbeatMisses);
+  vmixBackup.setActs(settings.tallyMode == TallyModeActs);
+  vmixBackup.setHeartbeat(settings.heartbeatMisses);
+}
+
+// Device name and access point password follow the tally number
+void setDeviceName()
 {
+  sprintf(deviceName, "vMix_Tally_%d", settings.tallyNumber);
+  sprintf(apPass, "%s%s", deviceName, "_access");
+}
+
+// Save changed settings and only redo what they affect
+void applySettings(const Settings &previous)
+{
+  bool wifiChanged = strcmp(settings.ssid, previous.ssid) != 0 || strcmp(settings.pass, previous.pass) != 0;
+  bool vmixChanged = strcmp(settings.hostName, previous.hostName) != 0 || settings.tallyMode != previous.tallyMode;
+  bool backupChanged = strcmp(settings.backupHostName, previous.backupHostName) != 0;
+
+  if (wifiChanged)
+  {
+    // Committed together with the new credentials by saveSettings()
+    clearWifiCache();
+  }
+
   saveSettings();
 
-  Serial.println();
-  Serial.println();
-  Serial.println("------------");
-  Serial.println("------------");
-  Serial.println("RESTART");
-  Serial.println("------------");
-  Serial.println("------------");
-  Serial.println();
-  Serial.println();
+  configureConnections();
 
-  start();
+  if (settings.tallyNumber != previous.tallyNumber)
+  {
+    // Takes effect on the device name at the next WiFi connection
+    setDeviceName();
+  }
+
+  if (settings.tallyNumber != previous.tallyNumber || settings.overlayMask != previous.overlayMask ||
+      memcmp(settings.extraInputs, previous.extraInputs, sizeof(settings.extraInputs)) != 0)
+  {
+    Serial.print("Following input ");
+    Serial.print(settings.tallyNumber);
+    Serial.print(" ");
+    Serial.println(formatInputs());
+    followInputs();
+  }
+
+  if (wifiChanged || apEnabled)
+  {
+    tallySetConnecting();
+    connectToWifi();
+  }
+  else if (vmixChanged && !wifiConnecting)
+  {
+    tallySetConnecting();
+    connectTovMix();
+  }
+  else if (backupChanged && !wifiConnecting)
+  {
+    // The primary keeps running, the tally switches away from the backup if it followed it
+    connectToBackup();
+  }
 }
 
 void start()
@@ -549,48 +1916,108 @@ void start()
   tallySetConnecting();
   
   loadSettings();
-  sprintf(deviceName, "vMix_Tally_%d", settings.tallyNumber);
-  sprintf(apPass, "%s%s", deviceName, "_access");
+  loadWifiCache();
+  bootStage(BootSettings);
+  setDeviceName();
+  configureConnections();
+  followInputs();
 
   connectToWifi();
-
-  if (WiFi.status() == WL_CONNECTED)
-  {
-    connectTovMix();
-  }
 }
 
 void setup()
 {
+  bootStage(BootSetup);
   Serial.begin(9600);
-  EEPROM.begin(512);
+  EEPROM.begin(EepromSize);
   SPIFFS.begin();
+  WiFi.persistent(false);
+  vmix.setSeed(ESP.getChipId());
+  vmixBackup.setSeed(ESP.getChipId() ^ 0x9E3779B9);
 
   httpServer.on("/", HTTP_GET, rootPageHandler);
   httpServer.on("/save", HTTP_POST, handleSave);
+  httpServer.on("/latency", HTTP_GET, latencyHandler);
+  httpServer.on("/metrics", HTTP_GET, metricsHandler);
+  httpServer.on("/events", HTTP_GET, eventsHandler);
+  httpServer.on("/api/status", HTTP_GET, apiStatusHandler);
+  httpServer.on("/api/settings", HTTP_GET, apiSettingsHandler);
+  httpServer.on("/api/settings", HTTP_POST, apiSaveHandler);
   httpServer.serveStatic("/", SPIFFS, "/", "max-age=315360000");
+  httpServer.collectHeaders(pageHeaders, 1);
   httpServer.begin();
 
+  scheduler.add("tally", tallyTask, 2000);
+  scheduler.add("display", displayTask, 500);
+  scheduler.add("reconnect", reconnectTask, 1000);
+  scheduler.add("http", httpTask, 5000);
+  scheduler.add("logging", loggingTask, 1000);
+
   start();
 }
 
-void loop()
+// Read and act on tally data from vMix
+void tallyTask()
 {
-  httpServer.handleClient();
+  if (!wifiConnecting && !apEnabled)
+  {
+    vmix.update();
+    vmixBackup.update();
+    selectHost();
+
+    // Which inputs changed is only worked out while a browser listens
+    if (events.subscribers() > 0)
+    {
+      sendInputsEvent();
+    }
+  }
+}
 
-  while (client.available())
+// Clock out any pending LED frame, a whole frame takes about 150 us of the task budget
+void displayTask()
+{
+  if (matrix.tick(MLED_QUEUE_LENGTH) && !matrix.busy() && latencyPending)
   {
-    String data = client.readStringUntil('\r\n');
-    handleData(data);
+    handleLatch();
   }
+}
 
-  if (!client.connected() && !apEnabled && millis() > lastCheck + interval)
+// Follow the WiFi association
+void reconnectTask()
+{
+  if (wifiConnecting)
   {
-    tallySetConnecting();
+    checkWifi();
+  }
+}
 
-    client.stop();
+// Serve the web pages and event streams
+void httpTask()
+{
+  httpServer.handleClient();
+  events.update();
+}
 
-    connectTovMix();
-    lastCheck = millis();
+// Serial commands and periodic samples
+void loggingTask()
+{
+  if (Serial.available())
+  {
+    handleSerial();
+  }
+
+  if (millis() - rssiSampled >= RssiInterval)
+  {
+    rssiSampled = millis();
+    sendRssiEvent();
   }
 }
+
+void loop()
+{
+  unsigned long loopStart = micros();
+
+  scheduler.run();
+
+  loopTime.record(micros() - loopStart);
+}
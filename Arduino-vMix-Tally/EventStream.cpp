@@ -0,0 +1,156 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Server-Sent Events to browsers, written without ever blocking loop()
+*/
+
+#include "EventStream.h"
+
+static const char EventHeaders[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/event-stream\r\n"
+  "Cache-Control: no-cache\r\n"
+  "Connection: keep-alive\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "\r\n"
+  "retry: 2000\n\n";
+
+EventStream::EventStream()
+{
+  sent = 0;
+  dropped = 0;
+
+  for (int i = 0; i < EventSubscribersMaxValue; i++)
+  {
+    subscriberList[i].active = false;
+    subscriberList[i].head = 0;
+    subscriberList[i].length = 0;
+  }
+}
+
+bool EventStream::subscribe(WiFiClient &client)
+{
+  for (int i = 0; i < EventSubscribersMaxValue; i++)
+  {
+    Subscriber &subscriber = subscriberList[i];
+
+    if (!subscriber.active)
+    {
+      subscriber.client = client;
+      subscriber.client.setNoDelay(true);
+      subscriber.active = true;
+      subscriber.head = 0;
+      subscriber.length = 0;
+
+      push(subscriber, EventHeaders, sizeof(EventHeaders) - 1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void EventStream::send(const char *event, const char *data)
+{
+  char message[EventMaxLength];
+  int length = snprintf(message, sizeof(message), "event: %s\ndata: %s\n\n", event, data);
+
+  if (length >= (int)sizeof(message))
+  {
+    return;
+  }
+
+  for (int i = 0; i < EventSubscribersMaxValue; i++)
+  {
+    Subscriber &subscriber = subscriberList[i];
+
+    if (subscriber.active && !push(subscriber, message, length))
+    {
+      dropped++;
+      drop(subscriber);
+    }
+  }
+
+  sent++;
+}
+
+void EventStream::update()
+{
+  for (int i = 0; i < EventSubscribersMaxValue; i++)
+  {
+    Subscriber &subscriber = subscriberList[i];
+
+    if (!subscriber.active)
+    {
+      continue;
+    }
+
+    if (!subscriber.client.connected())
+    {
+      drop(subscriber);
+      continue;
+    }
+
+    // Only write what fits in the socket buffer, so the write never waits
+    int length = subscriber.length;
+    int space = subscriber.client.availableForWrite();
+
+    if (length > EventQueueLength - subscriber.head)
+    {
+      length = EventQueueLength - subscriber.head;
+    }
+
+    if (length > space)
+    {
+      length = space;
+    }
+
+    if (length > 0)
+    {
+      int written = subscriber.client.write((const uint8_t *)subscriber.queue + subscriber.head, length);
+
+      subscriber.head = (subscriber.head + written) % EventQueueLength;
+      subscriber.length -= written;
+    }
+  }
+}
+
+int EventStream::subscribers()
+{
+  int count = 0;
+
+  for (int i = 0; i < EventSubscribersMaxValue; i++)
+  {
+    if (subscriberList[i].active)
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+bool EventStream::push(Subscriber &subscriber, const char *data, int length)
+{
+  if (subscriber.length + length > EventQueueLength)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < length; i++)
+  {
+    subscriber.queue[(subscriber.head + subscriber.length + i) % EventQueueLength] = data[i];
+  }
+
+  subscriber.length += length;
+  return true;
+}
+
+void EventStream::drop(Subscriber &subscriber)
+{
+  subscriber.client.stop();
+  subscriber.active = false;
+  subscriber.head = 0;
+  subscriber.length = 0;
+}
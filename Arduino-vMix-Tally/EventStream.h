@@ -0,0 +1,54 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Server-Sent Events to browsers, written without ever blocking loop()
+*/
+
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <WiFiClient.h>
+
+// Constants
+const int EventSubscribersMaxValue = 4;
+const int EventQueueLength = 512;
+const int EventMaxLength = 160;
+
+class EventStream
+{
+  public:
+    EventStream();
+
+    // Take over the client of the current http request, false when all slots are taken
+    bool subscribe(WiFiClient &client);
+
+    // Queue an event for every subscriber.
+    // A subscriber whose queue is full is disconnected, the browser reconnects by itself.
+    void send(const char *event, const char *data);
+
+    // Write queued data as far as the sockets accept it and drop closed subscribers
+    void update();
+
+    int subscribers();
+
+    unsigned long sent;
+    unsigned long dropped;
+
+  private:
+    struct Subscriber
+    {
+      WiFiClient client;
+      bool active;
+      char queue[EventQueueLength];
+      int head;
+      int length;
+    };
+
+    bool push(Subscriber &subscriber, const char *data, int length);
+    void drop(Subscriber &subscriber);
+
+    Subscriber subscriberList[EventSubscribersMaxValue];
+};
+
+#endif
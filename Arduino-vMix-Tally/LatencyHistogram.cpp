@@ -0,0 +1,105 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Fixed size log-linear histogram for latencies in microseconds
+*/
+
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void LatencyHistogram::reset()
+{
+  for (int i = 0; i < LatencyBuckets; i++)
+  {
+    buckets[i] = 0;
+  }
+
+  count = 0;
+  min = 0;
+  max = 0;
+  sum = 0;
+}
+
+void LatencyHistogram::record(uint32_t value)
+{
+  if (count == 0 || value < min)
+  {
+    min = value;
+  }
+
+  if (value > max)
+  {
+    max = value;
+  }
+
+  // Values beyond the range land in the last bucket
+  if (value > LatencyMaxValue)
+  {
+    value = LatencyMaxValue;
+  }
+
+  buckets[bucketOf(value)]++;
+  count++;
+  sum += value;
+}
+
+uint32_t LatencyHistogram::percentile(float percent) const
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  uint32_t rank = (uint32_t)(percent / 100.0f * count + 0.5f);
+  uint32_t seen = 0;
+
+  if (rank < 1)
+  {
+    rank = 1;
+  }
+
+  for (int i = 0; i < LatencyBuckets; i++)
+  {
+    seen += buckets[i];
+
+    if (seen >= rank)
+    {
+      // Never report more than was actually measured
+      return bucketMax(i) < max ? bucketMax(i) : max;
+    }
+  }
+
+  return max;
+}
+
+// Values below 8 get a bucket each, above that every power of two gets 8 buckets
+int LatencyHistogram::bucketOf(uint32_t value)
+{
+  if (value < LatencySubBuckets)
+  {
+    return value;
+  }
+
+  int magnitude = 31 - __builtin_clz(value);
+  int sub = (value >> (magnitude - 3)) & (LatencySubBuckets - 1);
+
+  return (magnitude - 2) * LatencySubBuckets + sub;
+}
+
+uint32_t LatencyHistogram::bucketMax(int bucket)
+{
+  if (bucket < LatencySubBuckets)
+  {
+    return bucket;
+  }
+
+  int magnitude = bucket / LatencySubBuckets + 2;
+  int sub = bucket % LatencySubBuckets;
+
+  return ((uint32_t)(LatencySubBuckets + sub + 1) << (magnitude - 3)) - 1;
+}
@@ -0,0 +1,42 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Fixed size log-linear histogram for latencies in microseconds
+*/
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Constants
+// Every power of two is split into 8 buckets, values are kept to within 12.5%
+const int LatencySubBuckets = 8;
+const uint32_t LatencyMaxValue = (1UL << 24) - 1;
+const int LatencyBuckets = 22 * LatencySubBuckets;
+
+class LatencyHistogram
+{
+  public:
+    LatencyHistogram();
+
+    void record(uint32_t value);
+    void reset();
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint32_t percentile(float percent) const;
+
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+
+  private:
+    static int bucketOf(uint32_t value);
+    static uint32_t bucketMax(int bucket);
+
+    uint32_t buckets[LatencyBuckets];
+};
+
+#endif
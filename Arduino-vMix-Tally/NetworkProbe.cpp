@@ -0,0 +1,137 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  DNS lookups and connection probes that run in the background, so a host that
+  is down never blocks loop(). Built on lwIP, the host tests use sockets.
+*/
+
+#include <lwip/dns.h>
+#include <lwip/tcp.h>
+#include "NetworkProbe.h"
+
+// lwIP calls these between two runs of loop()
+struct NetworkCallbacks
+{
+  static void lookupFound(const char *name, const ip_addr_t *found, void *arg)
+  {
+    NetworkProbe *probe = (NetworkProbe *)arg;
+
+    // Answers to a lookup that was abandoned or was for another host are dropped
+    if (probe->hostName == NULL || strcmp(name, probe->hostName) != 0)
+    {
+      return;
+    }
+
+    if (found != NULL)
+    {
+      probe->address = IPAddress(*found);
+      probe->result = 1;
+    }
+    else
+    {
+      probe->result = -1;
+    }
+  }
+
+  static err_t connected(void *arg, struct tcp_pcb *pcb, err_t err)
+  {
+    NetworkProbe *probe = (NetworkProbe *)arg;
+
+    probe->pending = NULL;
+    probe->result = 1;
+
+    // The host is up, the real connection is made by the caller
+    tcp_arg(pcb, NULL);
+    tcp_err(pcb, NULL);
+
+    if (tcp_close(pcb) != ERR_OK)
+    {
+      tcp_abort(pcb);
+      return ERR_ABRT;
+    }
+
+    return ERR_OK;
+  }
+
+  static void error(void *arg, err_t err)
+  {
+    NetworkProbe *probe = (NetworkProbe *)arg;
+
+    // lwIP already freed the pcb
+    probe->pending = NULL;
+    probe->result = -1;
+  }
+};
+
+NetworkProbe::NetworkProbe()
+{
+  result = 0;
+  hostName = NULL;
+  pending = NULL;
+}
+
+void NetworkProbe::lookup(const char *hostName)
+{
+  ip_addr_t found;
+
+  stop();
+  this->hostName = hostName;
+
+  err_t err = dns_gethostbyname(hostName, &found, NetworkCallbacks::lookupFound, this);
+
+  // Names in the DNS cache are answered right away
+  if (err == ERR_OK)
+  {
+    address = IPAddress(found);
+    result = 1;
+  }
+  else if (err != ERR_INPROGRESS)
+  {
+    result = -1;
+  }
+}
+
+void NetworkProbe::connect(const IPAddress &address, uint16_t port)
+{
+  stop();
+
+  struct tcp_pcb *pcb = tcp_new();
+
+  if (pcb == NULL)
+  {
+    result = -1;
+    return;
+  }
+
+  tcp_arg(pcb, this);
+  tcp_err(pcb, NetworkCallbacks::error);
+  pending = pcb;
+
+  if (tcp_connect(pcb, address, port, NetworkCallbacks::connected) != ERR_OK)
+  {
+    stop();
+    result = -1;
+  }
+}
+
+void NetworkProbe::stop()
+{
+  struct tcp_pcb *pcb = (struct tcp_pcb *)pending;
+
+  if (pcb != NULL)
+  {
+    tcp_arg(pcb, NULL);
+    tcp_err(pcb, NULL);
+    tcp_abort(pcb);
+    pending = NULL;
+  }
+
+  hostName = NULL;
+  result = 0;
+}
+
+int8_t NetworkProbe::poll()
+{
+  return result;
+}
@@ -0,0 +1,44 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  DNS lookups and connection probes that run in the background, so a host that
+  is down never blocks loop(). Built on lwIP, the host tests use sockets.
+*/
+
+#ifndef NETWORK_PROBE_H
+#define NETWORK_PROBE_H
+
+#include <IPAddress.h>
+
+class NetworkProbe
+{
+  public:
+    NetworkProbe();
+
+    // Start looking up a host name, address holds the answer once poll() returns 1
+    void lookup(const char *hostName);
+
+    // Start a connection to a host, it is closed again as soon as the host accepted it
+    void connect(const IPAddress &address, uint16_t port);
+
+    // Abandon the lookup or connection in progress, a late answer is ignored
+    void stop();
+
+    // 0 while waiting, 1 when the lookup or connection succeeded and -1 when it failed
+    int8_t poll();
+
+    IPAddress address;
+
+  private:
+    // Set from the callbacks of the network stack
+    volatile int8_t result;
+    const char *hostName;
+
+    // The connection in progress, a lwIP pcb or a socket
+    void *pending;
+
+    friend struct NetworkCallbacks;
+};
+
+#endif
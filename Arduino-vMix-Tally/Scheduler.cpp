@@ -0,0 +1,97 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Cooperative scheduler with priorities and time budgets for loop()
+*/
+
+#include <Arduino.h>
+#include "Scheduler.h"
+
+Scheduler::Scheduler(uint32_t frameBudget)
+{
+  this->frameBudget = frameBudget;
+  taskCount = 0;
+
+  reset();
+}
+
+bool Scheduler::add(const char *name, TaskFunction function, uint32_t budget)
+{
+  if (taskCount == SchedulerTasksMaxValue)
+  {
+    return false;
+  }
+
+  Task &task = tasks[taskCount++];
+  task.name = name;
+  task.function = function;
+  task.budget = budget;
+  task.runs = 0;
+  task.deferred = 0;
+  task.misses = 0;
+  task.runtime = 0;
+  task.maxRuntime = 0;
+  task.deferrals = 0;
+
+  return true;
+}
+
+void Scheduler::run()
+{
+  uint32_t frameStart = micros();
+
+  for (int i = 0; i < taskCount; i++)
+  {
+    Task &task = tasks[i];
+    uint32_t start = micros();
+
+    // Lower priority work yields to the next pass when the frame is nearly used up
+    if (i > 0 && start - frameStart + task.budget > frameBudget && task.deferrals < SchedulerMaxDeferrals)
+    {
+      task.deferrals++;
+      task.deferred++;
+      continue;
+    }
+
+    task.function();
+
+    uint32_t runtime = micros() - start;
+
+    task.deferrals = 0;
+    task.runs++;
+    task.runtime += runtime;
+
+    if (runtime > task.maxRuntime)
+    {
+      task.maxRuntime = runtime;
+    }
+
+    if (runtime > task.budget)
+    {
+      task.misses++;
+    }
+  }
+
+  frames++;
+
+  if (micros() - frameStart > frameBudget)
+  {
+    frameMisses++;
+  }
+}
+
+void Scheduler::reset()
+{
+  frames = 0;
+  frameMisses = 0;
+
+  for (int i = 0; i < taskCount; i++)
+  {
+    tasks[i].runs = 0;
+    tasks[i].deferred = 0;
+    tasks[i].misses = 0;
+    tasks[i].runtime = 0;
+    tasks[i].maxRuntime = 0;
+  }
+}
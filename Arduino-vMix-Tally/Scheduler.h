@@ -0,0 +1,58 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Cooperative scheduler with priorities and time budgets for loop()
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Constants
+const int SchedulerTasksMaxValue = 8;
+// A task is never deferred more often than this in a row
+const uint8_t SchedulerMaxDeferrals = 4;
+
+class Scheduler
+{
+  public:
+    typedef void (*TaskFunction)();
+
+    struct Task
+    {
+      const char *name;
+      TaskFunction function;
+      uint32_t budget;
+
+      unsigned long runs;
+      unsigned long deferred;
+      unsigned long misses;
+      uint64_t runtime;
+      uint32_t maxRuntime;
+      uint8_t deferrals;
+    };
+
+    // Every pass of run() should finish within the frame budget, in microseconds
+    Scheduler(uint32_t frameBudget);
+
+    // Tasks run in the order they are added, so add the most important task first.
+    // A task that runs longer than its budget, in microseconds, counts a deadline miss.
+    bool add(const char *name, TaskFunction function, uint32_t budget);
+
+    // Run every task once. The first task always runs, the others are deferred to the
+    // next pass when their budget no longer fits in what is left of the frame.
+    void run();
+
+    void reset();
+
+    Task tasks[SchedulerTasksMaxValue];
+    int taskCount;
+
+    uint32_t frameBudget;
+    unsigned long frames;
+    unsigned long frameMisses;
+};
+
+#endif
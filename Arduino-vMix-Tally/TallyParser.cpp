@@ -0,0 +1,398 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Streaming parser for the vMix TCP API
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "TallyParser.h"
+
+// Every tally line starts with this prefix, followed by one digit per input
+static const char TallyPrefix[] = "TALLY OK ";
+static const int TallyPrefixLength = sizeof(TallyPrefix) - 1;
+
+// Reply to the VERSION command
+static const char VersionPrefix[] = "VERSION OK";
+static const int VersionPrefixLength = sizeof(VersionPrefix) - 1;
+
+// Activator events start with this prefix, followed by "<name> <input> <value>"
+static const char ActsPrefix[] = "ACTS OK ";
+static const int ActsPrefixLength = sizeof(ActsPrefix) - 1;
+
+TallyParser::TallyParser(ResponseHandler responseHandler)
+{
+  this->responseHandler = responseHandler;
+
+  messages = 0;
+  activators = 0;
+  states = 0;
+  versions = 0;
+  offsets[0] = 0;
+  inputCount = 1;
+  lastInput = 1;
+  overlayMask = 0xFF;
+  pendingState = 0;
+  statePending = false;
+
+  memset(reported, '0', sizeof(reported));
+  reportedLength = 0;
+
+  reset();
+}
+
+void TallyParser::setInputs(const uint16_t *inputs, int count, uint8_t overlayMask)
+{
+  this->overlayMask = overlayMask;
+  inputCount = 0;
+  lastInput = 1;
+  resetActs();
+
+  for (int i = 0; i < count && inputCount < TallyInputsMaxValue; i++)
+  {
+    if (inputs[i] > 0 && inputs[i] <= TallyMaxLength)
+    {
+      offsets[inputCount++] = inputs[i] - 1;
+
+      if (inputs[i] > lastInput)
+      {
+        lastInput = inputs[i];
+      }
+    }
+  }
+
+  // A tally line being received may already be past the new inputs
+  if (phase == PhaseTally)
+  {
+    stateSeen = position >= lastInput;
+
+    if (stateSeen)
+    {
+      setState(combine(line, position));
+    }
+  }
+  else if (tallyValid)
+  {
+    setState(combine(tally, tallyLength));
+  }
+}
+
+void TallyParser::reset()
+{
+  memset(tally, '0', sizeof(tally));
+  tallyValid = false;
+  tallyChanged = true;
+  tallyLength = 0;
+
+  resetActs();
+  resetLine();
+}
+
+void TallyParser::resetActs()
+{
+  programs = 0;
+  previews = 0;
+  memset(overlays, 0, sizeof(overlays));
+  tallied = 0;
+  queryPending = false;
+}
+
+void TallyParser::resetLine()
+{
+  phase = PhasePrefix;
+  prefix = TallyPrefix;
+  prefixLength = TallyPrefixLength;
+  position = 0;
+  stateSeen = false;
+  responseLength = 0;
+}
+
+void TallyParser::feed(const uint8_t *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    feed((char)data[i]);
+  }
+}
+
+void TallyParser::feed(char c)
+{
+  if (c == '\r' || c == '\n')
+  {
+    endLine();
+    return;
+  }
+
+  switch (phase)
+  {
+    case PhasePrefix:
+      response[responseLength++] = c;
+
+      // The first character tells which prefix to expect
+      if (position == 0 && c == ActsPrefix[0])
+      {
+        prefix = ActsPrefix;
+        prefixLength = ActsPrefixLength;
+      }
+
+      if (c != prefix[position])
+      {
+        phase = PhaseResponse;
+      }
+      else if (++position == prefixLength)
+      {
+        phase = prefix == TallyPrefix ? PhaseTally : PhaseActs;
+        position = 0;
+      }
+      break;
+
+    case PhaseTally:
+      // Keep the line, so another input can be looked up later
+      if (position < TallyMaxLength)
+      {
+        line[position] = c;
+      }
+
+      // Record the state the moment the byte for the last of our inputs arrives
+      if (++position == lastInput)
+      {
+        stateSeen = true;
+        setState(combine(line, position));
+      }
+      break;
+
+    case PhaseActs:
+    case PhaseResponse:
+      // Responses longer than the buffer are truncated
+      if (responseLength < ResponseMaxLength - 1)
+      {
+        response[responseLength++] = c;
+      }
+      break;
+  }
+}
+
+bool TallyParser::takeQuery()
+{
+  bool query = queryPending;
+
+  queryPending = false;
+  return query;
+}
+
+bool TallyParser::takeState(char &state)
+{
+  if (!statePending)
+  {
+    return false;
+  }
+
+  state = pendingState;
+  statePending = false;
+  return true;
+}
+
+void TallyParser::endActs(char *event)
+{
+  char *number = strchr(event, ' ');
+  char *value = number ? strchr(number + 1, ' ') : NULL;
+
+  if (value == NULL)
+  {
+    return;
+  }
+
+  // Most events are about other inputs, so look up the input number first
+  int offset = atoi(number + 1) - 1;
+  int slot = 0;
+
+  while (slot < inputCount && offsets[slot] != offset)
+  {
+    slot++;
+  }
+
+  if (slot == inputCount)
+  {
+    return;
+  }
+
+  *number = '\0';
+  bool active = value[1] == '1';
+  bool program = false;
+  uint8_t bit = 1 << slot;
+
+  if (strcmp(event, "Input") == 0)
+  {
+    programs = active ? programs | bit : programs & ~bit;
+    program = true;
+  }
+  else if (strcmp(event, "InputPreview") == 0)
+  {
+    previews = active ? previews | bit : previews & ~bit;
+  }
+  else if (strncmp(event, "Overlay", 7) == 0 && event[7] >= '1' && event[7] <= '8' && event[8] == '\0')
+  {
+    uint8_t channel = 1 << (event[7] - '1');
+    overlays[slot] = active ? overlays[slot] | channel : overlays[slot] & ~channel;
+    program = true;
+  }
+  else
+  {
+    return;
+  }
+
+  // The tally line did not say whether this input was on program or on an overlay,
+  // when either goes off the other may still be on. It stays on program until the answer.
+  if (program && !active && (tallied & bit))
+  {
+    queryPending = true;
+  }
+
+  setState(combineActs());
+}
+
+char TallyParser::combine(const char *data, int length)
+{
+  // '0', '1' and '2' differ in the low two bits, so program and preview are a mask away
+  for (int i = 0; i < inputCount; i++)
+  {
+    uint8_t state = offsets[i] < length ? data[offsets[i]] & 3 : 0;
+    uint8_t bit = 1 << i;
+
+    previews = (previews & ~bit) | (state >> 1) << i;
+
+    if ((state & 1) == 0)
+    {
+      programs &= ~bit;
+      overlays[i] = 0;
+      tallied &= ~bit;
+    }
+    else if ((programs & bit) == 0 && overlays[i] == 0)
+    {
+      // Activator events tell program and overlays apart, the tally line does not
+      tallied |= bit;
+    }
+    else
+    {
+      tallied &= ~bit;
+    }
+  }
+
+  return combineActs();
+}
+
+char TallyParser::combineActs()
+{
+  uint8_t channels = 0;
+
+  for (int i = 0; i < inputCount; i++)
+  {
+    channels |= overlays[i];
+  }
+
+  // An input shown on a selected overlay channel is on program
+  return programs || tallied || (channels & overlayMask) ? '1' : previews ? '2' : '0';
+}
+
+int TallyParser::takeChanges(const uint16_t *&inputs)
+{
+  int count = 0;
+  int length = tallyLength > reportedLength ? tallyLength : reportedLength;
+
+  inputs = changes;
+
+  if (!tallyChanged)
+  {
+    return 0;
+  }
+
+  // Compare whole words, only the few words that differ are looked at byte by byte
+  for (int i = 0; i < length; i += TallyWordSize)
+  {
+    TallyWord current;
+    TallyWord previous;
+
+    memcpy(&current, tally + i, TallyWordSize);
+    memcpy(&previous, reported + i, TallyWordSize);
+
+    if (current != previous)
+    {
+      for (int j = i; j < i + TallyWordSize; j++)
+      {
+        if (tally[j] != reported[j])
+        {
+          if (count < TallyChangesMaxValue)
+          {
+            changes[count] = j + 1;
+          }
+
+          count++;
+        }
+      }
+
+      memcpy(reported + i, &current, TallyWordSize);
+    }
+  }
+
+  reportedLength = tallyLength;
+  tallyChanged = false;
+
+  return count;
+}
+
+void TallyParser::setState(char state)
+{
+  pendingState = state;
+  statePending = true;
+  states++;
+}
+
+void TallyParser::endLine()
+{
+  if (phase == PhaseTally)
+  {
+    messages++;
+
+    // Inputs beyond the end of the tally string are not in use
+    int length = position < TallyMaxLength ? position : TallyMaxLength;
+
+    memcpy(tally, line, length);
+
+    if (length < tallyLength)
+    {
+      memset(tally + length, '0', tallyLength - length);
+    }
+
+    tallyLength = length;
+    tallyValid = true;
+    tallyChanged = true;
+
+    if (!stateSeen)
+    {
+      setState(combine(tally, tallyLength));
+    }
+  }
+  else if (phase == PhaseActs)
+  {
+    activators++;
+
+    response[responseLength] = '\0';
+    endActs(response + ActsPrefixLength);
+  }
+  else if (responseLength > 0)
+  {
+    response[responseLength] = '\0';
+
+    if (strncmp(response, VersionPrefix, VersionPrefixLength) == 0)
+    {
+      versions++;
+    }
+    else
+    {
+      responseHandler(response);
+    }
+  }
+
+  resetLine();
+}
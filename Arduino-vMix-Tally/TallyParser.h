@@ -0,0 +1,123 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Streaming parser for the vMix TCP API
+*/
+
+#ifndef TALLY_PARSER_H
+#define TALLY_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Constants
+const int ResponseMaxLength = 64;
+const int TallyMaxLength = 1000;
+const int TallyInputsMaxValue = 8;
+const int TallyChangesMaxValue = 16;
+
+// Tally lines are compared a machine word at a time
+typedef uintptr_t TallyWord;
+const int TallyWordSize = sizeof(TallyWord);
+const int TallyBufferLength = (TallyMaxLength + TallyWordSize - 1) / TallyWordSize * TallyWordSize;
+
+class TallyParser
+{
+  public:
+    typedef void (*ResponseHandler)(const char *response);
+
+    TallyParser(ResponseHandler responseHandler);
+
+    // Select the inputs (1-based, up to TallyInputsMaxValue) whose combined state is reported,
+    // program wins over preview. Only the overlay channels in overlayMask count as program.
+    // The state of the new inputs is taken from the last tally line, if there was one.
+    void setInputs(const uint16_t *inputs, int count, uint8_t overlayMask);
+
+    // Forget any partially received line and the last tally line
+    void reset();
+
+    // Feed received bytes, the response handler is called for every complete line
+    // that is not a TALLY, ACTS or VERSION line
+    void feed(const uint8_t *data, size_t length);
+    void feed(char c);
+
+    // Take the newest tally state seen since the last call, if any
+    bool takeState(char &state);
+
+    // True once when an input that a tally line showed on program gets a program or overlay
+    // off event, send TALLY again to find out whether it is still on program
+    bool takeQuery();
+
+    // Take the inputs (1-based) whose state changed since the last call, returns how many changed.
+    // Only the first TallyChangesMaxValue of them are listed.
+    int takeChanges(const uint16_t *&inputs);
+
+    unsigned long messages;
+    unsigned long activators;
+    unsigned long states;
+
+    // Replies to the VERSION command, used as heartbeat
+    unsigned long versions;
+
+  private:
+    enum Phase
+    {
+      PhasePrefix,
+      PhaseTally,
+      PhaseActs,
+      PhaseResponse
+    };
+
+    void endLine();
+    void endActs(char *event);
+    void resetLine();
+    void resetActs();
+
+    char combine(const char *data, int length);
+    char combineActs();
+    void setState(char state);
+
+    ResponseHandler responseHandler;
+
+    Phase phase;
+    const char *prefix;
+    int prefixLength;
+    int position;
+    bool stateSeen;
+
+    // Offsets of our inputs in a tally line, the state is known once lastInput bytes arrived
+    uint16_t offsets[TallyInputsMaxValue];
+    int inputCount;
+    int lastInput;
+    uint8_t overlayMask;
+
+    // One bit per input on program or preview, and the overlay channels each input is on.
+    // A tally line shows overlays as program too, its program bits are kept in tallied
+    // for the inputs activator events have not reported on.
+    uint8_t programs;
+    uint8_t previews;
+    uint8_t overlays[TallyInputsMaxValue];
+    uint8_t tallied;
+    bool queryPending;
+
+    // The tally line being received, the last complete one and the one last taken by takeChanges().
+    // Inputs beyond the length of a line are kept as '0'.
+    char line[TallyMaxLength];
+    alignas(TallyWord) char tally[TallyBufferLength];
+    alignas(TallyWord) char reported[TallyBufferLength];
+    int tallyLength;
+    int reportedLength;
+    bool tallyValid;
+    bool tallyChanged;
+
+    uint16_t changes[TallyChangesMaxValue];
+
+    char pendingState;
+    bool statePending;
+
+    char response[ResponseMaxLength];
+    int responseLength;
+};
+
+#endif
@@ -0,0 +1,348 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Connection to the vMix TCP API, driven step by step from loop()
+*/
+
+#include "VmixConnection.h"
+
+VmixConnection::VmixConnection(TallyHandler tallyHandler, TallyParser::ResponseHandler responseHandler, StateHandler stateHandler)
+  : parser(responseHandler)
+{
+  this->tallyHandler = tallyHandler;
+  this->stateHandler = stateHandler;
+
+  state = StateIdle;
+  hostName = NULL;
+  port = 0;
+  acts = false;
+  attempts = 0;
+  reconnects = 0;
+  coalesced = 0;
+  receivedCycles = 0;
+  messageAt = 0;
+  lastRoundTrip = 0;
+  heartbeatsMissed = 0;
+  heartbeatTimeouts = 0;
+  heartbeatMisses = 0;
+  heartbeatInterval = HeartbeatInterval;
+  missed = 0;
+  heartbeatPending = false;
+  heartbeatAt = 0;
+  heartbeatSent = 0;
+  versions = 0;
+  receivedAt = 0;
+  connectDuration = 0;
+  connectedAt = 0;
+  lostAt = 0;
+  connectStart = 0;
+  waiting = false;
+  waitStart = 0;
+  failures = 0;
+  backoffStart = 0;
+  backoffDelay = 0;
+  jitter = 1;
+}
+
+void VmixConnection::setSeed(uint32_t seed)
+{
+  // Xorshift must never be seeded with zero
+  jitter = seed ? seed : 1;
+}
+
+void VmixConnection::setActs(bool acts)
+{
+  this->acts = acts;
+}
+
+void VmixConnection::setHeartbeat(uint8_t misses, unsigned long interval)
+{
+  heartbeatMisses = misses;
+  heartbeatInterval = interval;
+}
+
+void VmixConnection::setInputs(const uint16_t *inputs, int count, uint8_t overlayMask)
+{
+  char state;
+
+  parser.setInputs(inputs, count, overlayMask);
+
+  // Activator events only report changes, ask for the state of the new inputs
+  if (acts && connected())
+  {
+    client.print("TALLY\r\n");
+  }
+
+  if (parser.takeState(state))
+  {
+    receivedCycles = ESP.getCycleCount();
+    tallyHandler(state);
+  }
+}
+
+void VmixConnection::begin(const char *hostName, uint16_t port)
+{
+  this->hostName = hostName;
+  this->port = port;
+
+  client.stop();
+  stopWaiting();
+  failures = 0;
+  setState(StateResolve);
+}
+
+void VmixConnection::stop()
+{
+  client.stop();
+  stopWaiting();
+  setState(StateIdle);
+}
+
+bool VmixConnection::connected()
+{
+  return state == StateSubscribed;
+}
+
+void VmixConnection::update()
+{
+  int8_t result;
+
+  switch (state)
+  {
+    case StateIdle:
+      break;
+
+    case StateResolve:
+      // Skip the DNS lookup when the hostname is an IP address
+      if (!waiting && address.fromString(hostName))
+      {
+        setState(StateConnecting);
+      }
+      else if (!waiting)
+      {
+        startWaiting();
+        probe.lookup(hostName);
+      }
+      else if ((result = probe.poll()) > 0)
+      {
+        address = probe.address;
+        stopWaiting();
+        setState(StateConnecting);
+      }
+      else if (result < 0 || millis() - waitStart >= ResolveTimeout)
+      {
+        stopWaiting();
+        startBackoff();
+      }
+      break;
+
+    case StateConnecting:
+      // A host that is down would hold connect() for the whole timeout, so wait for
+      // a probe connection first, then connect() only waits for one round trip
+      if (!waiting)
+      {
+        attempts++;
+        startWaiting();
+        probe.connect(address, port);
+        break;
+      }
+
+      result = probe.poll();
+
+      if (result == 0 && millis() - waitStart < ConnectTimeout)
+      {
+        break;
+      }
+
+      stopWaiting();
+      client.setTimeout(ConnectTimeout);
+
+      if (result > 0 && client.connect(address, port))
+      {
+        client.setNoDelay(true);
+        parser.reset();
+        failures = 0;
+
+        missed = 0;
+        heartbeatPending = false;
+        heartbeatAt = millis();
+        versions = parser.versions;
+        receivedAt = micros();
+
+        // Subscribe to the tally events, activator events need a first TALLY to start from
+        client.print(acts ? "SUBSCRIBE ACTS\r\nTALLY\r\n" : "SUBSCRIBE TALLY\r\n");
+        setState(StateSubscribed);
+      }
+      else
+      {
+        startBackoff();
+      }
+      break;
+
+    case StateSubscribed:
+      read();
+
+      if (!client.connected())
+      {
+        reconnects++;
+        lostAt = micros();
+        setState(StateDraining);
+      }
+      else
+      {
+        heartbeat();
+      }
+      break;
+
+    case StateDraining:
+      // Deliver whatever arrived before the connection closed
+      read();
+      client.stop();
+      startBackoff();
+      break;
+
+    case StateBackoff:
+      if (millis() - backoffStart >= backoffDelay)
+      {
+        setState(StateResolve);
+      }
+      break;
+  }
+}
+
+void VmixConnection::read()
+{
+  unsigned long states = parser.states;
+  unsigned long lines = parser.messages + parser.activators;
+  uint32_t received = ESP.getCycleCount();
+  char state;
+
+  // Drain everything that is waiting before touching the display
+  while (client.available())
+  {
+    int length = client.read(readBuffer, sizeof(readBuffer));
+    parser.feed(readBuffer, length);
+    receivedAt = micros();
+  }
+
+  if (parser.takeQuery())
+  {
+    client.print("TALLY\r\n");
+  }
+
+  if (parser.messages + parser.activators != lines)
+  {
+    messageAt = millis();
+  }
+
+  // Only the newest state of a burst is shown
+  if (parser.takeState(state))
+  {
+    coalesced += parser.states - states - 1;
+    receivedCycles = received;
+    tallyHandler(state);
+  }
+}
+
+void VmixConnection::heartbeat()
+{
+  if (heartbeatMisses == 0)
+  {
+    return;
+  }
+
+  if (parser.versions != versions)
+  {
+    versions = parser.versions;
+
+    if (heartbeatPending)
+    {
+      lastRoundTrip = micros() - heartbeatSent;
+      roundTrip.record(lastRoundTrip);
+      heartbeatPending = false;
+      missed = 0;
+    }
+  }
+
+  if (millis() - heartbeatAt < heartbeatInterval)
+  {
+    return;
+  }
+
+  heartbeatAt = millis();
+
+  if (!heartbeatPending)
+  {
+    client.print("VERSION\r\n");
+    heartbeatPending = true;
+    heartbeatSent = micros();
+  }
+  else
+  {
+    missed++;
+    heartbeatsMissed++;
+
+    // A host that vanished without closing the connection, connected() would stay true for minutes
+    if (missed >= heartbeatMisses)
+    {
+      heartbeatTimeouts++;
+      reconnects++;
+      lostAt = receivedAt;
+      client.stop();
+      setState(StateDraining);
+    }
+  }
+}
+
+void VmixConnection::startWaiting()
+{
+  waiting = true;
+  waitStart = millis();
+}
+
+void VmixConnection::stopWaiting()
+{
+  probe.stop();
+  waiting = false;
+}
+
+void VmixConnection::startBackoff()
+{
+  // Exponential backoff with jitter, so tallies don't reconnect in lockstep
+  unsigned long maxDelay = BackoffMaxDelay;
+
+  if (failures < 16 && (BackoffMinDelay << failures) < BackoffMaxDelay)
+  {
+    maxDelay = BackoffMinDelay << failures;
+  }
+
+  jitter ^= jitter << 13;
+  jitter ^= jitter >> 17;
+  jitter ^= jitter << 5;
+
+  backoffDelay = maxDelay / 2 + jitter % (maxDelay / 2 + 1);
+  backoffStart = millis();
+  failures++;
+
+  setState(StateBackoff);
+}
+
+void VmixConnection::setState(State newState)
+{
+  if (state != newState)
+  {
+    if (newState == StateResolve)
+    {
+      connectStart = millis();
+    }
+    else if (newState == StateSubscribed)
+    {
+      connectedAt = millis();
+      connectDuration = connectedAt - connectStart;
+    }
+
+    state = newState;
+    stateHandler(state);
+  }
+}
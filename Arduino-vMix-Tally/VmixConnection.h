@@ -0,0 +1,136 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Connection to the vMix TCP API, driven step by step from loop()
+*/
+
+#ifndef VMIX_CONNECTION_H
+#define VMIX_CONNECTION_H
+
+#include <ESP8266WiFi.h>
+#include <WiFiClient.h>
+#include "LatencyHistogram.h"
+#include "NetworkProbe.h"
+#include "TallyParser.h"
+
+// Constants
+const unsigned long ResolveTimeout = 750;
+const unsigned long ConnectTimeout = 500;
+const unsigned long BackoffMinDelay = 500;
+const unsigned long BackoffMaxDelay = 10000;
+const unsigned long HeartbeatInterval = 200;
+
+class VmixConnection
+{
+  public:
+    enum State
+    {
+      StateIdle,
+      StateResolve,
+      StateConnecting,
+      StateSubscribed,
+      StateDraining,
+      StateBackoff
+    };
+
+    typedef void (*TallyHandler)(char state);
+    typedef void (*StateHandler)(State state);
+
+    VmixConnection(TallyHandler tallyHandler, TallyParser::ResponseHandler responseHandler, StateHandler stateHandler);
+
+    // Seed the backoff jitter, use something unique to the device
+    void setSeed(uint32_t seed);
+
+    // Follow activator events (SUBSCRIBE ACTS) instead of full tally lines,
+    // takes effect on the next connection
+    void setActs(bool acts);
+
+    // Send a VERSION command every interval milliseconds and drop the connection after
+    // the given number of missed replies in a row, 0 turns the heartbeat off. A host that
+    // went silent is given up (misses + 1) * interval after the last data it sent.
+    void setHeartbeat(uint8_t misses, unsigned long interval = HeartbeatInterval);
+
+    // Select the inputs to follow, their state is shown right away if it is known
+    void setInputs(const uint16_t *inputs, int count, uint8_t overlayMask);
+
+    // Start connecting to the given host, or stop all activity
+    void begin(const char *hostName, uint16_t port);
+    void stop();
+
+    // Do at most one step of work. The DNS lookup and the connection attempt run in the
+    // background, only a host that already accepted a connection is waited for.
+    void update();
+
+    bool connected();
+
+    State state;
+    TallyParser parser;
+    WiFiClient client;
+
+    unsigned long attempts;
+    unsigned long reconnects;
+
+    // Tally states that were superseded before they were shown
+    unsigned long coalesced;
+
+    // Cycle count when the data holding the last tally state was read
+    uint32_t receivedCycles;
+
+    // Time the last TALLY or ACTS line was received
+    unsigned long messageAt;
+
+    // Heartbeat round trip times in microseconds, missed replies and connections dropped for it
+    LatencyHistogram roundTrip;
+    uint32_t lastRoundTrip;
+    unsigned long heartbeatsMissed;
+    unsigned long heartbeatTimeouts;
+
+    // Time from starting to resolve until subscribed, and when that happened
+    unsigned long connectDuration;
+    unsigned long connectedAt;
+
+    // Time in microseconds the connection was lost, for a host that went silent
+    // the last time anything was received from it
+    uint32_t lostAt;
+
+  private:
+    void setState(State newState);
+    void startBackoff();
+    void read();
+    void heartbeat();
+    void startWaiting();
+    void stopWaiting();
+
+    TallyHandler tallyHandler;
+    StateHandler stateHandler;
+
+    const char *hostName;
+    uint16_t port;
+    bool acts;
+    IPAddress address;
+
+    // The DNS lookup or probe connection in progress
+    NetworkProbe probe;
+    bool waiting;
+    unsigned long waitStart;
+
+    unsigned long failures;
+    unsigned long connectStart;
+    unsigned long backoffStart;
+    unsigned long backoffDelay;
+    uint32_t jitter;
+
+    uint8_t heartbeatMisses;
+    unsigned long heartbeatInterval;
+    uint8_t missed;
+    bool heartbeatPending;
+    unsigned long heartbeatAt;
+    uint32_t heartbeatSent;
+    unsigned long versions;
+    uint32_t receivedAt;
+
+    uint8_t readBuffer[128];
+};
+
+#endif
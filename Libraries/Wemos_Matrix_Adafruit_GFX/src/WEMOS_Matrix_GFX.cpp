@@ -20,17 +20,126 @@ MLED::MLED(uint8_t _intensity, byte dataPin, byte clockPin) : Adafruit_GFX(8, 8)
 
 void MLED::writeDisplay() {
 
+	present();
+
+	while(busy())
+	{
+		tick(8);
+	}
+}
+
+void MLED::present()
+{
+	// Snapshot the drawing buffer, a transfer in progress keeps sending its own copy
+	noInterrupts();
+
+	for(uint8_t i=0;i<8;i++)
+	{
+		frontBuffer[i]=disBuffer[i];
+	}
+
+	frontIntensity=intensity;
+	frontPending=true;
+
+	interrupts();
+}
+
+bool MLED::busy()
+{
+	return frontPending || queueHead<queueLength;
+}
+
+bool MLED::tick(uint8_t maxBytes)
+{
+	if(queueHead==queueLength)
+	{
+		if(!frontPending)
+			return false;
+
+		latch();
+	}
+
+	while(maxBytes>0 && queueHead<queueLength)
+	{
+		uint16_t item=queue[queueHead++];
+
+		if(item&MLED_QUEUE_START)
+			start();
+
+		send(item&0xFF);
+
+		if(item&MLED_QUEUE_STOP)
+			stop();
+
+		maxBytes--;
+	}
+
+	return queueHead==queueLength;
+}
+
+void MLED::latch()
+{
+	uint8_t frame[8];
+	uint8_t frameIntensity;
+
+	noInterrupts();
+
+	for(uint8_t i=0;i<8;i++)
+	{
+		frame[i]=frontBuffer[i];
+	}
+
+	frameIntensity=frontIntensity;
+	frontPending=false;
+
+	interrupts();
+
+	queueHead=0;
+	queueLength=0;
+
+	// Find the rows that differ from what the chip holds
+	uint8_t first=8;
+	uint8_t last=0;
+
 	for(uint8_t i=0;i<8;i++)
 	{
-		sendData(i,disBuffer[i]);
+		if(!shadowValid || frame[i]!=shadow[i])
+		{
+			if(first==8)
+				first=i;
+			last=i;
+		}
+	}
+
+	if(first<8)
+	{
+		// Address auto-increment, the changed rows go out in a single transaction
+		queue[queueLength++]=MLED_QUEUE_START|MLED_QUEUE_STOP|0x40;
+		queue[queueLength++]=MLED_QUEUE_START|0xC0|first;
+
+		for(uint8_t i=first;i<=last;i++)
+		{
+			shadow[i]=frame[i];
+			queue[queueLength++]=shadow[i];
+		}
+
+		queue[queueLength-1]|=MLED_QUEUE_STOP;
+
+		rowsSent+=last-first+1;
+		rowsSkipped+=7-last+first;
+	}
+	else
+	{
+		rowsSkipped+=8;
+	}
 
-		digitalWrite(dataPin, LOW);
-  		digitalWrite(clockPin, LOW);
-  		digitalWrite(clockPin, HIGH);
-  		digitalWrite(dataPin, HIGH);
+	if(!shadowValid || frameIntensity!=shadowIntensity)
+	{
+		queue[queueLength++]=MLED_QUEUE_START|MLED_QUEUE_STOP|0x88|frameIntensity;
+		shadowIntensity=frameIntensity;
 	}
 
-	sendCommand(0x88|(intensity));
+	shadowValid=true;
 }
 
 void MLED::clear()
@@ -43,6 +152,13 @@ void MLED::clear()
 }
 
 
+void MLED::setFrame(const uint8_t frame[8])
+{
+	for(uint8_t i=0;i<8;i++)
+	{
+		disBuffer[i]=frame[i];
+	}
+}
 
 void MLED::drawPixel(int16_t  x, int16_t y, uint16_t color)
 {
@@ -64,26 +180,41 @@ void MLED::drawPixel(int16_t  x, int16_t y, uint16_t color)
 
 void MLED::sendCommand(byte cmd)
 {
-  digitalWrite(dataPin, LOW);
+  start();
   send(cmd);
-  digitalWrite(dataPin, HIGH);
+  stop();
 }
 
 void MLED::sendData(byte address, byte data)
 {
   sendCommand(0x44);
-  digitalWrite(dataPin, LOW);
+  start();
   send(0xC0 | address);
   send(data);
-  digitalWrite(dataPin, HIGH);
+  stop();
+}
+
+// Data falls while the clock is high
+void MLED::start()
+{
+  writePin(dataPin, LOW);
+}
+
+// Data rises while the clock is high, whatever the last bit sent was
+void MLED::stop()
+{
+  writePin(clockPin, LOW);
+  writePin(dataPin, LOW);
+  writePin(clockPin, HIGH);
+  writePin(dataPin, HIGH);
 }
 
 void MLED::send(byte data)
 {
   for (int i = 0; i < 8; i++) {
-    digitalWrite(clockPin, LOW);
-    digitalWrite(dataPin, data & 1 ? HIGH : LOW);
+    writePin(clockPin, LOW);
+    writePin(dataPin, data & 1 ? HIGH : LOW);
     data >>= 1;
-    digitalWrite(clockPin, HIGH);
+    writePin(clockPin, HIGH);
   }
 }
\ No newline at end of file
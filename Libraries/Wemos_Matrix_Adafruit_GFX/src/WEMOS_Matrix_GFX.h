@@ -14,31 +14,117 @@
 #define LED_ON 1
 #define LED_OFF 0
 
+// On the ESP8266 the pins are driven through the GPIO set/clear registers.
+// Define MLED_DIGITALWRITE before including this file to use digitalWrite() instead.
+#if defined(ESP8266) && !defined(MLED_DIGITALWRITE)
+ #define MLED_FAST_IO
+ // Keep every level at least 500ns, the TM1640 needs 400ns clock pulses
+ #define MLED_EDGE_CYCLES (F_CPU / 2000000)
+#endif
+
+// Flags on queued bus bytes
+#define MLED_QUEUE_START 0x100
+#define MLED_QUEUE_STOP 0x200
+
+// Bus bytes of the longest transfer: data command, address, 8 rows and display control.
+// tick(MLED_QUEUE_LENGTH) always sends a whole frame.
+#define MLED_QUEUE_LENGTH 11
+
+// Mirror a bitmap row, drawBitmap() puts the most significant bit on the left
+constexpr uint8_t mledReverse(uint8_t row)
+{
+	return ((row & 0x01) << 7) | ((row & 0x02) << 5) | ((row & 0x04) << 3) | ((row & 0x08) << 1) |
+	       ((row & 0x10) >> 1) | ((row & 0x20) >> 3) | ((row & 0x40) >> 5) | ((row & 0x80) >> 7);
+}
+
+// Build a frame for setFrame() at compile time from 8 bitmap rows, top row first.
+// The result is identical to drawBitmap(0, 0, rows, 8, 8, LED_ON) on a cleared display.
+#define MLED_FRAME(r0, r1, r2, r3, r4, r5, r6, r7) \
+	{ mledReverse(r7), mledReverse(r6), mledReverse(r5), mledReverse(r4), \
+	  mledReverse(r3), mledReverse(r2), mledReverse(r1), mledReverse(r0) }
+
 class MLED :  public Adafruit_GFX 
 {
 	public:
 		MLED(uint8_t _intensity=4, byte dataPin=D7, byte clockPin=D5);
+
+		// Send the drawing buffer and wait until it is on the display
 		void writeDisplay();
+
+		// Hand the drawing buffer to tick() without waiting.
+		// tick() clocks out at most maxBytes bus bytes per call, a frame is
+		// only replaced between transfers so rows never mix two frames.
+		// It returns true when the call finished sending a frame.
+		void present();
+		bool tick(uint8_t maxBytes=2);
+		bool busy();
+
 		void clear();
 		void drawPixel(int16_t  x, int16_t y, uint16_t color);
+		void setFrame(const uint8_t frame[8]);
 		
 
 
-	    volatile uint8_t disBuffer[8]={0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	    // Drawing buffer, nothing is sent until present() or writeDisplay()
+	    uint8_t disBuffer[8]={0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 	    uint8_t intensity;
+
+	    // Rows transmitted and rows skipped because the chip already held them
+	    unsigned long rowsSent=0;
+	    unsigned long rowsSkipped=0;
 	    
 
 	protected:
 		void sendCommand(byte led);
 	    void sendData(byte add, byte data);
 	    void send(byte data);
+	    void start();
+	    void stop();
+	    void latch();
+	    inline void writePin(byte pin, uint8_t value);
 
 	    byte dataPin;
 	    byte clockPin;
 
+	    // Last presented frame, waiting to be sent
+	    volatile uint8_t frontBuffer[8];
+	    volatile uint8_t frontIntensity;
+	    volatile bool frontPending=false;
+
+	    // Bus bytes of the transfer in progress
+	    uint16_t queue[MLED_QUEUE_LENGTH];
+	    uint8_t queueHead=0;
+	    uint8_t queueLength=0;
+
+	    // What the chip holds once the queue is sent
+	    uint8_t shadow[8];
+	    uint8_t shadowIntensity;
+	    bool shadowValid=false;
+
 	    
 
 };
+
+
+inline void MLED::writePin(byte pin, uint8_t value)
+{
+#ifdef MLED_FAST_IO
+	// GPIO16 is not on the set/clear registers
+	if(pin<16)
+	{
+		uint32_t edge=ESP.getCycleCount();
+
+		if(value)
+			GPOS=(1<<pin);
+		else
+			GPOC=(1<<pin);
+
+		while(ESP.getCycleCount()-edge<MLED_EDGE_CYCLES);
+		return;
+	}
+#endif
+	digitalWrite(pin, value);
+}
 	
 
 #endif
@@ -0,0 +1,631 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  vMix TCP API simulator for load testing tallies without a vMix machine.
+  Speaks the part of the API the tally firmware uses and plays a scenario script.
+
+  Build on Linux:
+    g++ -O2 -std=c++11 -o vmix-simulator vMix-Simulator.cpp
+
+  Usage:
+    vmix-simulator [-p port] [-l logfile] [-s seed] [script]
+
+  Every message sent to subscribers is written to the log as
+    <microseconds since epoch> <subscribers> <message>
+  so tally side latency can be computed from the same clock.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Constants
+const int InputsMaxValue = 1000;
+const size_t OutputMaxLength = 65536;
+const size_t InputMaxLength = 1024;
+const int EventsMaxValue = 256;
+
+// Connected client
+struct Client
+{
+  int fd;
+  bool tally;
+  bool acts;
+  std::string input;
+  std::string output;
+};
+
+// Scenario step
+struct Step
+{
+  std::string command;
+  double a;
+  double b;
+};
+
+// Server state
+int port = 8099;
+int listenFd = -1;
+int epollFd = -1;
+FILE *logFile = NULL;
+std::map<int, Client> clients;
+
+// Production state
+int inputs = 8;
+int program = 1;
+int preview = 2;
+bool halfOpen = false;
+
+// Scenario state
+std::vector<Step> script;
+size_t stepIndex = 0;
+double stepEnd = 0;
+double nextCut = 0;
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+long long wallMicros()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Build the TALLY OK message for the current production state
+std::string tallyMessage()
+{
+  std::string message = "TALLY OK ";
+  message.reserve(message.size() + inputs + 2);
+
+  for (int i = 1; i <= inputs; i++)
+  {
+    if (i == program)
+      message += '1';
+    else if (i == preview)
+      message += '2';
+    else
+      message += '0';
+  }
+
+  message += "\r\n";
+  return message;
+}
+
+// Wait for the events a client needs, nothing at all while half open
+void watchClient(Client &client, int operation)
+{
+  struct epoll_event event;
+  event.events = 0;
+  event.data.fd = client.fd;
+
+  if (!halfOpen)
+  {
+    event.events = EPOLLIN;
+
+    if (!client.output.empty())
+      event.events |= EPOLLOUT;
+  }
+
+  epoll_ctl(epollFd, operation, client.fd, &event);
+}
+
+void setHalfOpen(bool enabled)
+{
+  halfOpen = enabled;
+
+  for (std::map<int, Client>::iterator it = clients.begin(); it != clients.end(); ++it)
+    watchClient(it->second, EPOLL_CTL_MOD);
+}
+
+void closeClient(int fd)
+{
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+  close(fd);
+  clients.erase(fd);
+}
+
+// Queue data for a client, slow clients are dropped instead of buffering forever
+bool sendClient(Client &client, const std::string &data)
+{
+  if (client.output.empty())
+  {
+    ssize_t sent = send(client.fd, data.data(), data.size(), MSG_NOSIGNAL);
+
+    if (sent == (ssize_t)data.size())
+      return true;
+
+    if (sent < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        return false;
+      sent = 0;
+    }
+
+    client.output.assign(data, sent, std::string::npos);
+  }
+  else
+  {
+    client.output += data;
+  }
+
+  if (client.output.size() > OutputMaxLength)
+    return false;
+
+  watchClient(client, EPOLL_CTL_MOD);
+  return true;
+}
+
+void flushClient(Client &client)
+{
+  ssize_t sent = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+
+  if (sent < 0)
+  {
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      closeClient(client.fd);
+    return;
+  }
+
+  client.output.erase(0, sent);
+
+  if (client.output.empty())
+    watchClient(client, EPOLL_CTL_MOD);
+}
+
+// Send a message to every subscriber of TALLY or ACTS and log it
+void broadcast(const std::string &message, bool acts)
+{
+  if (halfOpen)
+    return;
+
+  long long start = wallMicros();
+  std::vector<int> dropped;
+  int subscribers = 0;
+
+  for (std::map<int, Client>::iterator it = clients.begin(); it != clients.end(); ++it)
+  {
+    Client &client = it->second;
+
+    if (acts ? !client.acts : !client.tally)
+      continue;
+
+    subscribers++;
+
+    if (!sendClient(client, message))
+      dropped.push_back(client.fd);
+  }
+
+  for (size_t i = 0; i < dropped.size(); i++)
+    closeClient(dropped[i]);
+
+  if (logFile)
+  {
+    fprintf(logFile, "%lld %d %.*s\n", start, subscribers, (int)message.size() - 2, message.c_str());
+  }
+}
+
+// The input on program or preview as the tallies see it, 0 when it is beyond the inputs
+int shown(int input)
+{
+  return input >= 1 && input <= inputs ? input : 0;
+}
+
+// Send the ACTS events for the program and preview inputs that changed
+void broadcastActs(int oldProgram, int oldPreview)
+{
+  const char *names[] = {"Input", "InputPreview"};
+  int olds[] = {oldProgram, oldPreview};
+  int news[] = {shown(program), shown(preview)};
+  char message[64];
+
+  for (int i = 0; i < 2; i++)
+  {
+    if (olds[i] == news[i])
+      continue;
+
+    if (olds[i] > 0)
+    {
+      snprintf(message, sizeof(message), "ACTS OK %s %d 0\r\n", names[i], olds[i]);
+      broadcast(message, true);
+    }
+
+    if (news[i] > 0)
+    {
+      snprintf(message, sizeof(message), "ACTS OK %s %d 1\r\n", names[i], news[i]);
+      broadcast(message, true);
+    }
+  }
+}
+
+// Take the preview to program and pick a new preview
+void cut()
+{
+  int oldProgram = shown(program);
+  int oldPreview = shown(preview);
+
+  program = preview;
+  preview = 1 + rand() % inputs;
+
+  if (inputs > 1)
+  {
+    while (preview == program)
+      preview = 1 + rand() % inputs;
+  }
+
+  broadcast(tallyMessage(), false);
+  broadcastActs(oldProgram, oldPreview);
+}
+
+void handleCommand(Client &client, const std::string &command)
+{
+  if (halfOpen)
+    return;
+
+  std::string response;
+
+  if (command == "SUBSCRIBE TALLY")
+  {
+    client.tally = true;
+    response = "SUBSCRIBE OK TALLY\r\n" + tallyMessage();
+  }
+  else if (command == "SUBSCRIBE ACTS")
+  {
+    client.acts = true;
+    response = "SUBSCRIBE OK ACTS\r\n";
+  }
+  else if (command == "UNSUBSCRIBE TALLY")
+  {
+    client.tally = false;
+    response = "UNSUBSCRIBE OK TALLY\r\n";
+  }
+  else if (command == "UNSUBSCRIBE ACTS")
+  {
+    client.acts = false;
+    response = "UNSUBSCRIBE OK ACTS\r\n";
+  }
+  else if (command == "TALLY")
+  {
+    response = tallyMessage();
+  }
+  else if (command == "VERSION")
+  {
+    response = "VERSION OK 23.0.0.31\r\n";
+  }
+  else if (!command.empty())
+  {
+    response = command + " ER Unknown command\r\n";
+  }
+
+  if (!response.empty() && !sendClient(client, response))
+    closeClient(client.fd);
+}
+
+void readClient(int fd)
+{
+  char buffer[512];
+  ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+
+  if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    closeClient(fd);
+    return;
+  }
+
+  if (length < 0)
+    return;
+
+  Client &client = clients[fd];
+  client.input.append(buffer, length);
+
+  size_t end;
+  while ((end = client.input.find('\n')) != std::string::npos)
+  {
+    std::string command = client.input.substr(0, end);
+
+    if (!command.empty() && command[command.size() - 1] == '\r')
+      command.erase(command.size() - 1);
+
+    client.input.erase(0, end + 1);
+    handleCommand(client, command);
+
+    // The client may have been dropped while answering
+    if (clients.find(fd) == clients.end())
+      return;
+  }
+
+  if (client.input.size() > InputMaxLength)
+    closeClient(fd);
+}
+
+void startListening()
+{
+  listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+  int on = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+
+  if (bind(listenFd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listenFd, 1024) < 0)
+  {
+    perror("listen");
+    exit(1);
+  }
+
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = listenFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+}
+
+void stopListening()
+{
+  while (!clients.empty())
+    closeClient(clients.begin()->first);
+
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, NULL);
+  close(listenFd);
+  listenFd = -1;
+}
+
+void acceptClients()
+{
+  int fd;
+
+  while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+  {
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    Client client;
+    client.fd = fd;
+    client.tally = false;
+    client.acts = false;
+    clients[fd] = client;
+    watchClient(clients[fd], EPOLL_CTL_ADD);
+  }
+}
+
+// Scenario script, one step per line:
+//   inputs <n>               number of inputs in the production (1-1000)
+//   program <n>              put input n on program
+//   preview <n>              put input n on preview
+//   cut <per second> <s>     cut at the given rate for s seconds
+//   burst <n>                n cuts back to back
+//   wait <s>                 do nothing for s seconds
+//   restart <s>              drop all connections and refuse new ones for s seconds
+//   halfopen <s>             keep connections open but stop answering for s seconds
+//   loop                     start the script again
+void loadScript(const char *path)
+{
+  FILE *file = fopen(path, "r");
+
+  if (!file)
+  {
+    perror(path);
+    exit(1);
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), file))
+  {
+    char command[32];
+    Step step;
+    step.a = 0;
+    step.b = 0;
+
+    if (line[0] == '#' || sscanf(line, "%31s %lf %lf", command, &step.a, &step.b) < 1)
+      continue;
+
+    step.command = command;
+    script.push_back(step);
+  }
+
+  fclose(file);
+}
+
+// Advance the scenario, returns the time of the next scenario event
+double runScript(double time)
+{
+  while (stepIndex < script.size())
+  {
+    Step &step = script[stepIndex];
+
+    if (step.command == "cut")
+    {
+      if (stepEnd == 0)
+      {
+        stepEnd = time + step.b;
+        nextCut = time;
+      }
+
+      if (time < stepEnd)
+      {
+        if (time >= nextCut)
+        {
+          cut();
+          nextCut += 1.0 / step.a;
+        }
+        return nextCut < stepEnd ? nextCut : stepEnd;
+      }
+    }
+    else if (step.command == "wait" || step.command == "restart" || step.command == "halfopen")
+    {
+      if (stepEnd == 0)
+      {
+        stepEnd = time + step.a;
+
+        if (step.command == "restart")
+          stopListening();
+        else if (step.command == "halfopen")
+          setHalfOpen(true);
+      }
+
+      if (time < stepEnd)
+        return stepEnd;
+
+      if (step.command == "restart")
+        startListening();
+      else if (step.command == "halfopen")
+        setHalfOpen(false);
+    }
+    else if (step.command == "inputs" || step.command == "program" || step.command == "preview")
+    {
+      int oldProgram = shown(program);
+      int oldPreview = shown(preview);
+
+      if (step.command == "inputs")
+      {
+        inputs = (int)step.a;
+        if (inputs < 1)
+          inputs = 1;
+        if (inputs > InputsMaxValue)
+          inputs = InputsMaxValue;
+      }
+      else if (step.command == "program")
+        program = (int)step.a;
+      else
+        preview = (int)step.a;
+
+      // Subscribers of ACTS get the same change as activator events
+      broadcast(tallyMessage(), false);
+      broadcastActs(oldProgram, oldPreview);
+    }
+    else if (step.command == "burst")
+    {
+      for (int i = 0; i < (int)step.a; i++)
+        cut();
+    }
+    else if (step.command == "loop")
+    {
+      stepIndex = 0;
+      stepEnd = 0;
+      continue;
+    }
+    else
+    {
+      fprintf(stderr, "Unknown script command: %s\n", step.command.c_str());
+    }
+
+    stepIndex++;
+    stepEnd = 0;
+  }
+
+  return -1;
+}
+
+int main(int argc, char **argv)
+{
+  int option;
+  unsigned seed = time(NULL);
+
+  while ((option = getopt(argc, argv, "p:l:s:")) != -1)
+  {
+    switch (option)
+    {
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'l':
+        logFile = fopen(optarg, "w");
+        break;
+      case 's':
+        seed = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-p port] [-l logfile] [-s seed] [script]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  srand(seed);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (optind < argc)
+  {
+    loadScript(argv[optind]);
+  }
+  else
+  {
+    // Without a script, cut every two seconds forever
+    Step step;
+    step.command = "cut";
+    step.a = 0.5;
+    step.b = 1e9;
+    script.push_back(step);
+  }
+
+  epollFd = epoll_create1(0);
+  startListening();
+  printf("vMix simulator listening on port %d\n", port);
+
+  struct epoll_event events[EventsMaxValue];
+
+  while (true)
+  {
+    double next = runScript(now());
+    int timeout = -1;
+
+    if (next >= 0)
+    {
+      timeout = (int)((next - now()) * 1000) + 1;
+      if (timeout < 0)
+        timeout = 0;
+    }
+
+    if (logFile)
+      fflush(logFile);
+
+    int count = epoll_wait(epollFd, events, EventsMaxValue, timeout);
+
+    for (int i = 0; i < count; i++)
+    {
+      int fd = events[i].data.fd;
+
+      if (fd == listenFd)
+      {
+        acceptClients();
+        continue;
+      }
+
+      if (clients.find(fd) == clients.end())
+        continue;
+
+      if (events[i].events & (EPOLLERR | EPOLLHUP))
+      {
+        closeClient(fd);
+        continue;
+      }
+
+      if (events[i].events & EPOLLOUT)
+        flushClient(clients[fd]);
+
+      if (clients.find(fd) != clients.end() && (events[i].events & EPOLLIN))
+        readClient(fd);
+    }
+  }
+}
@@ -0,0 +1,107 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Counts the heap allocations of the host tests and benchmarks
+*/
+
+#include <new>
+#include <stdlib.h>
+#include "AllocationCounter.h"
+
+// The address sanitizer brings its own malloc, elsewhere glibc's malloc is wrapped
+#if defined(__SANITIZE_ADDRESS__)
+#define COUNT_MALLOC 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define COUNT_MALLOC 0
+#endif
+#endif
+
+#ifndef COUNT_MALLOC
+#ifdef __GLIBC__
+#define COUNT_MALLOC 1
+#else
+#define COUNT_MALLOC 0
+#endif
+#endif
+
+unsigned long hostAllocations = 0;
+size_t hostLargestAllocation = 0;
+
+static inline void countAllocation(size_t size)
+{
+  hostAllocations++;
+
+  if (size > hostLargestAllocation)
+  {
+    hostLargestAllocation = size;
+  }
+}
+
+void *operator new(size_t size)
+{
+  void *memory = malloc(size ? size : 1);
+
+  if (memory == NULL)
+  {
+    throw std::bad_alloc();
+  }
+
+#if !COUNT_MALLOC
+  countAllocation(size);
+#endif
+  return memory;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void *memory, size_t size) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory, size_t size) noexcept
+{
+  free(memory);
+}
+
+#if COUNT_MALLOC
+extern "C"
+{
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t count, size_t size);
+  void *__libc_realloc(void *memory, size_t size);
+
+  void *malloc(size_t size)
+  {
+    countAllocation(size);
+    return __libc_malloc(size);
+  }
+
+  void *calloc(size_t count, size_t size)
+  {
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+  }
+
+  void *realloc(void *memory, size_t size)
+  {
+    countAllocation(size);
+    return __libc_realloc(memory, size);
+  }
+}
+#endif
@@ -0,0 +1,21 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Counts the heap allocations of the host tests and benchmarks, link
+  AllocationCounter.cpp to count them
+*/
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <stddef.h>
+
+// Heap allocations since the program started: calls of malloc, calloc and realloc
+// with glibc, which new uses too, elsewhere and under the address sanitizer only new
+extern unsigned long hostAllocations;
+
+// Size of the largest of them, a test may reset it
+extern size_t hostLargestAllocation;
+
+#endif
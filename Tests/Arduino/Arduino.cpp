@@ -0,0 +1,183 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Minimal Arduino API for building parts of the firmware on a computer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "Arduino.h"
+
+EspClass ESP;
+HardwareSerial Serial;
+HostGpioRegister GPOS(HIGH);
+HostGpioRegister GPOC(LOW);
+
+// Cycles a read of the cycle counter takes, so busy waits on it end with a set clock
+static const uint32_t CycleCountCost = 10;
+
+static bool clockSet = false;
+static unsigned long clockMicros = 0;
+static uint32_t clockCycles = 0;
+static HostPinHandler pinHandler = NULL;
+
+static unsigned long realMicros()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void hostSetMicros(unsigned long now)
+{
+  clockSet = true;
+  clockMicros = now;
+  clockCycles = 0;
+}
+
+void hostAdvanceMicros(unsigned long time)
+{
+  clockMicros += time;
+}
+
+void hostOnDigitalWrite(HostPinHandler handler)
+{
+  pinHandler = handler;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pinHandler != NULL)
+  {
+    pinHandler(pin, value);
+  }
+}
+
+void HostGpioRegister::operator=(uint32_t mask)
+{
+  for (uint8_t pin = 0; pin < 16; pin++)
+  {
+    if (mask & (1 << pin))
+    {
+      digitalWrite(pin, value);
+    }
+  }
+}
+
+unsigned long micros()
+{
+  return (uint32_t)(clockSet ? clockMicros : realMicros());
+}
+
+unsigned long millis()
+{
+  return (uint32_t)((clockSet ? clockMicros : realMicros()) / 1000);
+}
+
+// A set clock moves by the delay, so waiting in the firmware costs a test no time
+void delay(unsigned long ms)
+{
+  if (clockSet)
+  {
+    clockMicros += ms * 1000;
+  }
+  else
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+void yield()
+{
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  if (!clockSet)
+  {
+    return (uint32_t)(realMicros() * getCpuFreqMHz());
+  }
+
+  uint32_t cycles = (uint32_t)(clockMicros * getCpuFreqMHz() + clockCycles);
+
+  clockCycles += CycleCountCost;
+  clockMicros += clockCycles / getCpuFreqMHz();
+  clockCycles %= getCpuFreqMHz();
+
+  return cycles;
+}
+
+uint8_t EspClass::getCpuFreqMHz()
+{
+  return 80;
+}
+
+uint32_t EspClass::getChipId()
+{
+  return 0x00C0FFEE;
+}
+
+// The heap of a tally running the firmware, the host heap tells nothing about it
+uint32_t EspClass::getFreeHeap()
+{
+  return 40000;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize()
+{
+  return 30000;
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  static bool echo = getenv("TALLY_SERIAL") != NULL;
+
+  if (echo)
+  {
+    fwrite(buffer, 1, size, stdout);
+  }
+
+  return size;
+}
+
+int HardwareSerial::available()
+{
+  return input.size();
+}
+
+int HardwareSerial::read()
+{
+  if (input.empty())
+  {
+    return -1;
+  }
+
+  int c = (uint8_t)input[0];
+  input.erase(0, 1);
+  return c;
+}
+
+int HardwareSerial::peek()
+{
+  return input.empty() ? -1 : (uint8_t)input[0];
+}
+
+void HardwareSerial::hostInput(const char *text)
+{
+  input += text;
+}
@@ -0,0 +1,90 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Minimal Arduino API for building parts of the firmware on a computer
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binary.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F_CPU 80000000L
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+// Wemos D1 mini pins
+#define D5 14
+#define D7 13
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(text) (text)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define noInterrupts()
+#define interrupts()
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+class EspClass
+{
+  public:
+    uint32_t getCycleCount();
+    uint8_t getCpuFreqMHz();
+    uint32_t getChipId();
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize();
+};
+
+extern EspClass ESP;
+
+// The GPIO set and clear registers of the ESP8266, writing a mask drives
+// those pins high or low the way digitalWrite() does
+class HostGpioRegister
+{
+  public:
+    explicit HostGpioRegister(uint8_t value) : value(value) {}
+    void operator=(uint32_t mask);
+
+  private:
+    uint8_t value;
+};
+
+extern HostGpioRegister GPOS;
+extern HostGpioRegister GPOC;
+
+// The clock runs in real time until a test sets it, then it only moves when the test moves it
+// and by a few cycles for every read of the cycle counter
+void hostSetMicros(unsigned long now);
+void hostAdvanceMicros(unsigned long time);
+
+// Called for every digitalWrite(), so tests can follow a bus
+typedef void (*HostPinHandler)(uint8_t pin, uint8_t value);
+void hostOnDigitalWrite(HostPinHandler handler);
+
+#include "HardwareSerial.h"
+
+#endif
@@ -0,0 +1,41 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 EEPROM for building parts of the firmware on a computer, kept in memory
+*/
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass()
+{
+  hostErase();
+}
+
+void EEPROMClass::begin(size_t size)
+{
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+  return data[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+  data[address] = value;
+}
+
+bool EEPROMClass::commit()
+{
+  commits++;
+  return true;
+}
+
+void EEPROMClass::hostErase()
+{
+  memset(data, 0xFF, sizeof(data));
+  commits = 0;
+}
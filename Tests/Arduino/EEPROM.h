@@ -0,0 +1,44 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 EEPROM for building parts of the firmware on a computer, kept in memory
+*/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+  public:
+    EEPROMClass();
+
+    void begin(size_t size);
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    bool commit();
+
+    template<typename T> T &get(int address, T &value)
+    {
+      memcpy(&value, data + address, sizeof(T));
+      return value;
+    }
+
+    template<typename T> const T &put(int address, const T &value)
+    {
+      memcpy(data + address, &value, sizeof(T));
+      return value;
+    }
+
+    // Test side: the erased flash reads all ones, commits count the writes to flash
+    void hostErase();
+
+    uint8_t data[4096];
+    unsigned long commits;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
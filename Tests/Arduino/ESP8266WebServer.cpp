@@ -0,0 +1,144 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 web server for building parts of the firmware on a computer.
+  It does not listen, a test hands requests to hostRequest() and reads the response.
+*/
+
+#include "ESP8266WebServer.h"
+
+ESP8266WebServer::ESP8266WebServer(int port)
+{
+  contentLength = CONTENT_LENGTH_UNKNOWN;
+  hostKeepBody = true;
+}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler)
+{
+  routes.push_back({uri, method, handler});
+}
+
+void ESP8266WebServer::serveStatic(const char *uri, FS &fs, const char *path, const char *cacheHeader)
+{
+}
+
+void ESP8266WebServer::collectHeaders(const char *headerKeys[], size_t count)
+{
+  this->headerKeys.assign(headerKeys, headerKeys + count);
+}
+
+void ESP8266WebServer::begin()
+{
+}
+
+void ESP8266WebServer::handleClient()
+{
+}
+
+WiFiClient ESP8266WebServer::client()
+{
+  return requestClient;
+}
+
+bool ESP8266WebServer::hasArg(const String &name)
+{
+  return requestArgs.count(name) > 0;
+}
+
+String ESP8266WebServer::arg(const String &name)
+{
+  return hasArg(name) ? String(requestArgs[name]) : String();
+}
+
+// Only the headers asked for by collectHeaders() are kept, like on the ESP8266
+String ESP8266WebServer::header(const String &name)
+{
+  for (size_t i = 0; i < headerKeys.size(); i++)
+  {
+    if (headerKeys[i] == name && requestHeaders.count(name) > 0)
+    {
+      return String(requestHeaders[name]);
+    }
+  }
+
+  return String();
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first)
+{
+  if (first)
+  {
+    response.headers.insert(response.headers.begin(), std::make_pair(name, value));
+  }
+  else
+  {
+    response.headers.push_back(std::make_pair(name, value));
+  }
+}
+
+void ESP8266WebServer::setContentLength(size_t length)
+{
+  contentLength = length;
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const String &content)
+{
+  response.code = code;
+  response.contentType = contentType;
+  write(content.data(), content.size());
+}
+
+void ESP8266WebServer::sendContent(const String &content)
+{
+  write(content.data(), content.size());
+}
+
+void ESP8266WebServer::sendContent_P(PGM_P content, size_t size)
+{
+  write(content, size);
+}
+
+void ESP8266WebServer::write(const char *data, size_t size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+
+  if (response.writes == 0)
+  {
+    response.firstByteAt = micros();
+  }
+
+  if (hostKeepBody)
+  {
+    response.body.append(data, size);
+  }
+
+  response.length += size;
+  response.writes++;
+  response.lastByteAt = micros();
+}
+
+bool ESP8266WebServer::hostRequest(HTTPMethod method, const char *uri, const HostFields &args, const HostFields &headers, WiFiClient client)
+{
+  response = HostResponse();
+  response.code = 0;
+  response.length = 0;
+  contentLength = CONTENT_LENGTH_UNKNOWN;
+  requestArgs = args;
+  requestHeaders = headers;
+  requestClient = client;
+
+  for (size_t i = 0; i < routes.size(); i++)
+  {
+    if (routes[i].uri == uri && (routes[i].method == HTTP_ANY || routes[i].method == method))
+    {
+      routes[i].handler();
+      return true;
+    }
+  }
+
+  return false;
+}
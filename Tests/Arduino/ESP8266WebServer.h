@@ -0,0 +1,110 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 web server for building parts of the firmware on a computer.
+  It does not listen, a test hands requests to hostRequest() and reads the response.
+*/
+
+#ifndef ESP8266_WEB_SERVER_H
+#define ESP8266_WEB_SERVER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "FS.h"
+#include "WiFiClient.h"
+
+enum HTTPMethod
+{
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_POST
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class ESP8266WebServer
+{
+  public:
+    typedef void (*THandlerFunction)();
+
+    ESP8266WebServer(int port = 80);
+
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+    void serveStatic(const char *uri, FS &fs, const char *path, const char *cacheHeader = NULL);
+    void collectHeaders(const char *headerKeys[], size_t count);
+    void begin();
+    void handleClient();
+
+    WiFiClient client();
+    bool hasArg(const String &name);
+    String arg(const String &name);
+    String header(const String &name);
+
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void setContentLength(size_t length);
+    void send(int code, const char *contentType, const String &content);
+    void sendContent(const String &content);
+    void sendContent_P(PGM_P content, size_t size);
+
+    template<typename T> size_t streamFile(T &file, const String &contentType)
+    {
+      uint8_t buffer[256];
+      int length;
+      size_t sent = 0;
+
+      send(200, contentType.c_str(), "");
+
+      while ((length = file.read(buffer, sizeof(buffer))) > 0)
+      {
+        sendContent_P((const char *)buffer, length);
+        sent += length;
+      }
+
+      return sent;
+    }
+
+    // What a handler sent, the times are in microseconds
+    struct HostResponse
+    {
+      int code;
+      String contentType;
+      std::vector<std::pair<String, String>> headers;
+      String body;
+      size_t length;
+      unsigned long writes;
+      unsigned long firstByteAt;
+      unsigned long lastByteAt;
+    };
+
+    // Test side: run the handler of a request, false when none matches
+    typedef std::map<std::string, std::string> HostFields;
+    bool hostRequest(HTTPMethod method, const char *uri, const HostFields &args = HostFields(),
+                     const HostFields &headers = HostFields(), WiFiClient client = WiFiClient());
+
+    HostResponse response;
+
+    // Keep the response body, benchmarks turn it off so recording it costs no memory
+    bool hostKeepBody;
+
+  private:
+    struct Route
+    {
+      String uri;
+      HTTPMethod method;
+      THandlerFunction handler;
+    };
+
+    void write(const char *data, size_t size);
+
+    std::vector<Route> routes;
+    std::vector<String> headerKeys;
+    HostFields requestArgs;
+    HostFields requestHeaders;
+    WiFiClient requestClient;
+    size_t contentLength;
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 WiFi for building parts of the firmware on a computer.
+  The station joins a simulated access point, hostWifi sets how it behaves.
+*/
+
+#include "ESP8266WiFi.h"
+
+HostWifi hostWifi = {
+  "ssid default",
+  "pass default",
+  {0x02, 0x00, 0x00, 0x00, 0x00, 0x01},
+  6,
+  IPAddress(127, 0, 0, 1),
+  2000,
+  300,
+  500,
+  0,
+  0,
+  0
+};
+
+ESP8266WiFiClass WiFi;
+
+bool ESP8266WiFiClass::mode(WiFiMode_t mode)
+{
+  wifiMode = mode;
+  return true;
+}
+
+bool ESP8266WiFiClass::hostname(const char *name)
+{
+  return true;
+}
+
+bool ESP8266WiFiClass::persistent(bool persistent)
+{
+  return true;
+}
+
+bool ESP8266WiFiClass::config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns)
+{
+  staticIp = (uint32_t)ip != 0;
+  this->ip = ip;
+
+  if (staticIp)
+  {
+    hostWifi.staticConfigs++;
+  }
+
+  return true;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *pass, int32_t channel, const uint8_t *bssid)
+{
+  bool scan = channel == 0 || bssid == NULL;
+
+  hostWifi.begins++;
+  joining = true;
+  joinStart = millis();
+  joinTime = hostWifi.associateTime + (staticIp ? 0 : hostWifi.dhcpTime);
+
+  if (scan)
+  {
+    hostWifi.scans++;
+    joinTime += hostWifi.scanTime;
+  }
+
+  // A cached access point that moved is never found, the station keeps trying
+  found = strcmp(ssid, hostWifi.ssid) == 0 && strcmp(pass, hostWifi.pass) == 0 &&
+          (scan || (channel == hostWifi.channel && memcmp(bssid, hostWifi.bssid, sizeof(hostWifi.bssid)) == 0));
+
+  return status();
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff)
+{
+  joining = false;
+  return true;
+}
+
+wl_status_t ESP8266WiFiClass::status()
+{
+  if (!joining || (wifiMode != WIFI_STA && wifiMode != WIFI_AP_STA))
+  {
+    return WL_IDLE_STATUS;
+  }
+
+  if (!found || millis() - joinStart < joinTime)
+  {
+    return WL_DISCONNECTED;
+  }
+
+  return WL_CONNECTED;
+}
+
+IPAddress ESP8266WiFiClass::localIP()
+{
+  if (status() != WL_CONNECTED)
+  {
+    return IPAddress();
+  }
+
+  return staticIp ? ip : hostWifi.ip;
+}
+
+uint8_t *ESP8266WiFiClass::BSSID()
+{
+  return hostWifi.bssid;
+}
+
+int32_t ESP8266WiFiClass::channel()
+{
+  return hostWifi.channel;
+}
+
+int32_t ESP8266WiFiClass::RSSI()
+{
+  return -60;
+}
+
+uint8_t *ESP8266WiFiClass::macAddress(uint8_t *mac)
+{
+  static const uint8_t address[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+  memcpy(mac, address, sizeof(address));
+  return mac;
+}
+
+bool ESP8266WiFiClass::softAP(const char *ssid, const char *pass)
+{
+  return true;
+}
+
+IPAddress ESP8266WiFiClass::softAPIP()
+{
+  return IPAddress(192, 168, 4, 1);
+}
@@ -0,0 +1,91 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 WiFi for building parts of the firmware on a computer.
+  The station joins a simulated access point, hostWifi sets how it behaves.
+*/
+
+#ifndef ESP8266_WIFI_H
+#define ESP8266_WIFI_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} WiFiMode_t;
+
+// The simulated access point and the time each step of joining it takes, in milliseconds
+struct HostWifi
+{
+  const char *ssid;
+  const char *pass;
+  uint8_t bssid[6];
+  int32_t channel;
+  IPAddress ip;
+
+  // Scanning all channels for the SSID, skipped when the BSSID and channel are given
+  unsigned long scanTime;
+  unsigned long associateTime;
+  unsigned long dhcpTime;
+
+  // What the station was asked to do
+  unsigned long begins;
+  unsigned long scans;
+  unsigned long staticConfigs;
+};
+
+extern HostWifi hostWifi;
+
+class ESP8266WiFiClass
+{
+  public:
+    bool mode(WiFiMode_t mode);
+    bool hostname(const char *name);
+    bool persistent(bool persistent);
+
+    // An address of 0 turns DHCP on
+    bool config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns = (uint32_t)0);
+    wl_status_t begin(const char *ssid, const char *pass, int32_t channel = 0, const uint8_t *bssid = NULL);
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status();
+
+    IPAddress localIP();
+    uint8_t *BSSID();
+    int32_t channel();
+    int32_t RSSI();
+    uint8_t *macAddress(uint8_t *mac);
+
+    bool softAP(const char *ssid, const char *pass);
+    IPAddress softAPIP();
+
+  private:
+    WiFiMode_t wifiMode = WIFI_OFF;
+    bool joining = false;
+    bool found = false;
+    bool staticIp = false;
+    IPAddress ip;
+    unsigned long joinStart = 0;
+    unsigned long joinTime = 0;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,106 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 file system for building parts of the firmware on a computer, kept in memory
+*/
+
+#include "FS.h"
+
+FS SPIFFS;
+
+namespace fs
+{
+
+size_t File::write(uint8_t c)
+{
+  if (!contents)
+  {
+    return 0;
+  }
+
+  contents->push_back(c);
+  return 1;
+}
+
+int File::available()
+{
+  return contents ? contents->size() - position : 0;
+}
+
+int File::read()
+{
+  uint8_t c;
+
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::read(uint8_t *buffer, size_t size)
+{
+  size_t length = available();
+
+  if (length > size)
+  {
+    length = size;
+  }
+
+  if (length > 0)
+  {
+    memcpy(buffer, contents->data() + position, length);
+    position += length;
+  }
+
+  return length;
+}
+
+int File::peek()
+{
+  return available() > 0 ? (uint8_t)(*contents)[position] : -1;
+}
+
+size_t File::size()
+{
+  return contents ? contents->size() : 0;
+}
+
+void File::close()
+{
+  contents.reset();
+  position = 0;
+}
+
+bool FS::begin()
+{
+  return true;
+}
+
+bool FS::exists(const char *path)
+{
+  return files.count(path) > 0;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+  if (mode[0] == 'w')
+  {
+    files[path] = std::make_shared<std::string>();
+  }
+  else if (!exists(path))
+  {
+    return File();
+  }
+
+  return File(files[path]);
+}
+
+void FS::hostWrite(const char *path, const std::string &contents)
+{
+  files[path] = std::make_shared<std::string>(contents);
+}
+
+void FS::hostRemove(const char *path)
+{
+  files.erase(path);
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino ESP8266 file system for building parts of the firmware on a computer, kept in memory
+*/
+
+#ifndef FS_H
+#define FS_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+namespace fs
+{
+
+class File : public Stream
+{
+  public:
+    File() {}
+    explicit File(std::shared_ptr<std::string> contents) : contents(contents) {}
+
+    size_t write(uint8_t c) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buffer, size_t size);
+    int peek() override;
+    size_t size();
+    void close();
+
+    operator bool() const
+    {
+      return contents != NULL;
+    }
+
+  private:
+    std::shared_ptr<std::string> contents;
+    size_t position = 0;
+};
+
+class FS
+{
+  public:
+    bool begin();
+    bool exists(const char *path);
+    File open(const char *path, const char *mode);
+
+    // Test side: add or remove an uploaded file
+    void hostWrite(const char *path, const std::string &contents);
+    void hostRemove(const char *path);
+
+  private:
+    std::map<std::string, std::shared_ptr<std::string>> files;
+};
+
+}
+
+using fs::File;
+using fs::FS;
+
+extern FS SPIFFS;
+
+#endif
@@ -0,0 +1,37 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino serial port for building parts of the firmware on a computer. What the
+  firmware prints goes to stdout when the TALLY_SERIAL environment variable is set.
+*/
+
+#ifndef HARDWARE_SERIAL_H
+#define HARDWARE_SERIAL_H
+
+#include <string>
+#include "Stream.h"
+
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long baud);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    // Test side: characters for the firmware to read
+    void hostInput(const char *text);
+
+  private:
+    std::string input;
+};
+
+extern HardwareSerial Serial;
+
+#endif
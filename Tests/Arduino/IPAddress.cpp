@@ -0,0 +1,67 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino IPv4 address for building parts of the firmware on a computer
+*/
+
+#include <stdio.h>
+#include "IPAddress.h"
+
+IPAddress::IPAddress(uint32_t address)
+{
+  memcpy(bytes, &address, sizeof(bytes));
+}
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+{
+  bytes[0] = first;
+  bytes[1] = second;
+  bytes[2] = third;
+  bytes[3] = fourth;
+}
+
+IPAddress::operator uint32_t() const
+{
+  uint32_t address;
+
+  memcpy(&address, bytes, sizeof(address));
+  return address;
+}
+
+// Only dotted decimal addresses, anything else is a host name
+bool IPAddress::fromString(const char *text)
+{
+  unsigned int parts[4];
+  char end;
+
+  if (sscanf(text, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &end) != 4)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    if (parts[i] > 255)
+    {
+      return false;
+    }
+
+    bytes[i] = parts[i];
+  }
+
+  return true;
+}
+
+String IPAddress::toString() const
+{
+  char text[16];
+
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+  return String(text);
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+  return p.print(toString());
+}
@@ -0,0 +1,41 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino IPv4 address for building parts of the firmware on a computer
+*/
+
+#ifndef IP_ADDRESS_H
+#define IP_ADDRESS_H
+
+#include "Arduino.h"
+#include "Printable.h"
+
+class IPAddress : public Printable
+{
+  public:
+    IPAddress(uint32_t address = 0);
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+
+    // In network byte order, like lwIP stores it
+    operator uint32_t() const;
+
+    uint8_t operator[](int index) const
+    {
+      return bytes[index];
+    }
+
+    uint8_t &operator[](int index)
+    {
+      return bytes[index];
+    }
+
+    bool fromString(const char *text);
+    String toString() const;
+    size_t printTo(Print &p) const override;
+
+  private:
+    uint8_t bytes[4];
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  DNS lookups and connection probes for building the firmware on a computer.
+  Lookups are answered right away, probes are non-blocking sockets that poll() checks.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "NetworkProbe.h"
+
+NetworkProbe::NetworkProbe()
+{
+  result = 0;
+  hostName = NULL;
+  pending = NULL;
+}
+
+void NetworkProbe::lookup(const char *hostName)
+{
+  struct addrinfo hints;
+  struct addrinfo *found;
+
+  stop();
+  this->hostName = hostName;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  if (getaddrinfo(hostName, NULL, &hints, &found) != 0)
+  {
+    result = -1;
+    return;
+  }
+
+  address = IPAddress(((struct sockaddr_in *)found->ai_addr)->sin_addr.s_addr);
+  result = 1;
+  freeaddrinfo(found);
+}
+
+void NetworkProbe::connect(const IPAddress &address, uint16_t port)
+{
+  struct sockaddr_in peer;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  stop();
+
+  if (fd < 0)
+  {
+    result = -1;
+    return;
+  }
+
+  memset(&peer, 0, sizeof(peer));
+  peer.sin_family = AF_INET;
+  peer.sin_port = htons(port);
+  peer.sin_addr.s_addr = (uint32_t)address;
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  if (::connect(fd, (struct sockaddr *)&peer, sizeof(peer)) < 0 && errno != EINPROGRESS)
+  {
+    close(fd);
+    result = -1;
+    return;
+  }
+
+  pending = new int(fd);
+}
+
+void NetworkProbe::stop()
+{
+  int *fd = (int *)pending;
+
+  if (fd != NULL)
+  {
+    close(*fd);
+    delete fd;
+    pending = NULL;
+  }
+
+  hostName = NULL;
+  result = 0;
+}
+
+int8_t NetworkProbe::poll()
+{
+  int *fd = (int *)pending;
+
+  if (fd == NULL || result != 0)
+  {
+    return result;
+  }
+
+  struct pollfd wait = {*fd, POLLOUT, 0};
+  int error = 0;
+  socklen_t length = sizeof(error);
+
+  if (::poll(&wait, 1, 0) == 0)
+  {
+    return 0;
+  }
+
+  getsockopt(*fd, SOL_SOCKET, SO_ERROR, &error, &length);
+  result = error == 0 ? 1 : -1;
+
+  // The host is up, the real connection is made by the caller
+  close(*fd);
+  delete fd;
+  pending = NULL;
+
+  return result;
+}
@@ -0,0 +1,148 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino Print class for building parts of the firmware on a computer
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string>
+#include "Print.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t written = 0;
+
+  while (written < size && write(buffer[written]))
+  {
+    written++;
+  }
+
+  return written;
+}
+
+size_t Print::print(const char *text)
+{
+  return write(text);
+}
+
+size_t Print::print(const String &text)
+{
+  return write(text.c_str(), text.length());
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base)
+{
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base)
+{
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base)
+{
+  return print(String(value, base));
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  return print(String(value, base));
+}
+
+size_t Print::print(double value, int digits)
+{
+  char buffer[32];
+
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return print(buffer);
+}
+
+size_t Print::print(const Printable &value)
+{
+  return value.printTo(*this);
+}
+
+size_t Print::println()
+{
+  return write("\r\n");
+}
+
+size_t Print::println(const char *text)
+{
+  return print(text) + println();
+}
+
+size_t Print::println(const String &text)
+{
+  return print(text) + println();
+}
+
+size_t Print::println(char c)
+{
+  return print(c) + println();
+}
+
+size_t Print::println(unsigned char value, int base)
+{
+  return print(value, base) + println();
+}
+
+size_t Print::println(int value, int base)
+{
+  return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base)
+{
+  return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base)
+{
+  return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base)
+{
+  return print(value, base) + println();
+}
+
+size_t Print::println(double value, int digits)
+{
+  return print(value, digits) + println();
+}
+
+size_t Print::println(const Printable &value)
+{
+  return print(value) + println();
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  int length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+
+  std::string text(length, '\0');
+
+  va_start(args, format);
+  vsnprintf(&text[0], length + 1, format, args);
+  va_end(args);
+
+  return write(text.data(), text.size());
+}
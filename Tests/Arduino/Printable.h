@@ -0,0 +1,23 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino Printable for building parts of the firmware on a computer
+*/
+
+#ifndef PRINTABLE_H
+#define PRINTABLE_H
+
+#include <stddef.h>
+
+class Print;
+
+class Printable
+{
+  public:
+    virtual ~Printable() {}
+
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+#endif
@@ -0,0 +1,29 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino Stream class for building parts of the firmware on a computer
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout)
+    {
+      _timeout = timeout;
+    }
+
+  protected:
+    unsigned long _timeout = 1000;
+};
+
+#endif
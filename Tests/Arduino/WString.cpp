@@ -0,0 +1,57 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino String for building parts of the firmware on a computer
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "WString.h"
+
+// Digits of a number in the given base, most significant first
+static std::string formatNumber(unsigned long value, unsigned char base, bool negative)
+{
+  std::string digits;
+
+  do
+  {
+    digits.insert(digits.begin(), "0123456789abcdefghijklmnopqrstuvwxyz"[value % base]);
+    value /= base;
+  } while (value > 0);
+
+  return negative ? "-" + digits : digits;
+}
+
+String::String(int value, unsigned char base) : String((long)value, base)
+{
+}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base)
+{
+}
+
+String::String(long value, unsigned char base)
+  : std::string(base == DEC ? formatNumber(value < 0 ? -(unsigned long)value : value, base, value < 0) : formatNumber((unsigned long)value, base, false))
+{
+}
+
+String::String(unsigned long value, unsigned char base) : std::string(formatNumber(value, base, false))
+{
+}
+
+long String::toInt() const
+{
+  return atol(c_str());
+}
+
+void String::toCharArray(char *buffer, unsigned int size) const
+{
+  if (size == 0)
+  {
+    return;
+  }
+
+  strncpy(buffer, c_str(), size - 1);
+  buffer[size - 1] = '\0';
+}
@@ -0,0 +1,38 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino String for building parts of the firmware on a computer
+*/
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <string>
+
+#define DEC 10
+#define HEX 16
+
+class __FlashStringHelper;
+
+class String : public std::string
+{
+  public:
+    String(const char *text = "") : std::string(text != NULL ? text : "") {}
+    String(const std::string &text) : std::string(text) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(int value, unsigned char base = DEC);
+    explicit String(unsigned int value, unsigned char base = DEC);
+    explicit String(long value, unsigned char base = DEC);
+    explicit String(unsigned long value, unsigned char base = DEC);
+
+    unsigned int length() const
+    {
+      return size();
+    }
+
+    long toInt() const;
+    void toCharArray(char *buffer, unsigned int size) const;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino WiFiClient for building parts of the firmware on a computer, on a
+  TCP socket. Copies share the connection like they do on the ESP8266.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "WiFiClient.h"
+
+// The socket buffer the ESP8266 has for one connection
+const size_t SendBufferSize = 1460;
+
+// The socket is closed when the last copy of the client is gone
+static std::shared_ptr<int> shareSocket(int fd)
+{
+  return std::shared_ptr<int>(new int(fd), [](int *socket)
+  {
+    if (*socket >= 0)
+    {
+      close(*socket);
+    }
+
+    delete socket;
+  });
+}
+
+WiFiClient::WiFiClient() : socket(shareSocket(-1))
+{
+}
+
+WiFiClient::WiFiClient(int socket) : socket(shareSocket(socket))
+{
+  fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+}
+
+int WiFiClient::connect(const IPAddress &address, uint16_t port)
+{
+  struct sockaddr_in peer;
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+  stop();
+  socket = shareSocket(-1);
+
+  if (fd < 0)
+  {
+    return 0;
+  }
+
+  memset(&peer, 0, sizeof(peer));
+  peer.sin_family = AF_INET;
+  peer.sin_port = htons(port);
+  peer.sin_addr.s_addr = (uint32_t)address;
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  if (::connect(fd, (struct sockaddr *)&peer, sizeof(peer)) < 0 && errno != EINPROGRESS)
+  {
+    close(fd);
+    return 0;
+  }
+
+  struct pollfd wait = {fd, POLLOUT, 0};
+  int error = 0;
+  socklen_t length = sizeof(error);
+
+  if (poll(&wait, 1, _timeout) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+  {
+    close(fd);
+    return 0;
+  }
+
+  *socket = fd;
+  return 1;
+}
+
+// Data that arrived before the peer closed can still be read, like on the ESP8266
+uint8_t WiFiClient::connected()
+{
+  char c;
+
+  if (*socket < 0)
+  {
+    return 0;
+  }
+
+  ssize_t peeked = recv(*socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return peeked > 0 || (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+int WiFiClient::available()
+{
+  int length = 0;
+
+  if (*socket < 0 || ioctl(*socket, FIONREAD, &length) < 0)
+  {
+    return 0;
+  }
+
+  return length;
+}
+
+int WiFiClient::read()
+{
+  uint8_t c;
+
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+  if (*socket < 0)
+  {
+    return -1;
+  }
+
+  ssize_t length = recv(*socket, buffer, size, MSG_DONTWAIT);
+  return length > 0 ? length : -1;
+}
+
+int WiFiClient::peek()
+{
+  uint8_t c;
+
+  if (*socket < 0 || recv(*socket, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1)
+  {
+    return -1;
+  }
+
+  return c;
+}
+
+size_t WiFiClient::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+  if (*socket < 0)
+  {
+    return 0;
+  }
+
+  ssize_t written = send(*socket, buffer, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+  return written > 0 ? written : 0;
+}
+
+// What fits in the send buffer of the ESP8266, less what the socket still holds
+size_t WiFiClient::availableForWrite()
+{
+  int queued = 0;
+
+  if (*socket < 0 || ioctl(*socket, TIOCOUTQ, &queued) < 0 || (size_t)queued >= SendBufferSize)
+  {
+    return 0;
+  }
+
+  return SendBufferSize - queued;
+}
+
+void WiFiClient::setNoDelay(bool noDelay)
+{
+  int value = noDelay;
+
+  if (*socket >= 0)
+  {
+    setsockopt(*socket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+  }
+}
+
+void WiFiClient::stop()
+{
+  if (*socket >= 0)
+  {
+    close(*socket);
+    *socket = -1;
+  }
+}
+
+WiFiClient::operator bool()
+{
+  return *socket >= 0;
+}
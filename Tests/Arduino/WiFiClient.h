@@ -0,0 +1,45 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Arduino WiFiClient for building parts of the firmware on a computer, on a
+  TCP socket. Copies share the connection like they do on the ESP8266.
+*/
+
+#ifndef WIFI_CLIENT_H
+#define WIFI_CLIENT_H
+
+#include <memory>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiClient : public Stream
+{
+  public:
+    WiFiClient();
+
+    // Take over a connected socket, as a server hands out its clients
+    explicit WiFiClient(int socket);
+
+    // Waits for at most the stream timeout
+    int connect(const IPAddress &address, uint16_t port);
+
+    uint8_t connected();
+    int available() override;
+    int read() override;
+    int read(uint8_t *buffer, size_t size);
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    size_t availableForWrite();
+    void setNoDelay(bool noDelay);
+    void stop();
+
+    operator bool();
+
+  private:
+    std::shared_ptr<int> socket;
+};
+
+#endif
@@ -0,0 +1,28 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Checks for the host tests, a test fails when any of its checks failed
+*/
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      checkFailures++; \
+    } \
+  } while (0)
+
+// Exit code of a test
+#define CHECK_RESULT() (checkFailures == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,183 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  A vMix TCP API server on the loopback interface for the host tests, it does
+  its work when the test calls update()
+*/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "FakeVmix.h"
+
+// Connections the listener queues, a stall fills the queue with one more
+const int ListenBacklog = 4;
+
+FakeVmix::FakeVmix(const char *address, uint16_t port)
+{
+  struct sockaddr_in local;
+  socklen_t length = sizeof(local);
+  int reuse = 1;
+
+  accepted = 0;
+  versions = 0;
+  silent = false;
+  stalled = false;
+  tally = "0";
+
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  inet_pton(AF_INET, address, &local.sin_addr);
+
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+  if (bind(listener, (struct sockaddr *)&local, sizeof(local)) < 0 || listen(listener, ListenBacklog) < 0)
+  {
+    perror("FakeVmix");
+    abort();
+  }
+
+  getsockname(listener, (struct sockaddr *)&local, &length);
+  this->port = ntohs(local.sin_port);
+}
+
+FakeVmix::~FakeVmix()
+{
+  closeAll();
+  setStalled(false);
+  close(listener);
+}
+
+void FakeVmix::setTally(const char *tally)
+{
+  this->tally = tally;
+
+  for (size_t i = 0; i < clients.size(); i++)
+  {
+    if (clients[i].subscribed)
+    {
+      send(clients[i], "TALLY OK " + this->tally + "\r\n");
+    }
+  }
+}
+
+void FakeVmix::setSilent(bool silent)
+{
+  this->silent = silent;
+}
+
+// The listener stops accepting and connections fill its queue, so the
+// handshakes of all later connections are dropped until they time out
+void FakeVmix::setStalled(bool stalled)
+{
+  struct sockaddr_in local;
+  socklen_t length = sizeof(local);
+
+  this->stalled = stalled;
+
+  if (stalled && fillers.empty())
+  {
+    getsockname(listener, (struct sockaddr *)&local, &length);
+
+    for (int i = 0; i <= ListenBacklog; i++)
+    {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+      connect(fd, (struct sockaddr *)&local, sizeof(local));
+      fillers.push_back(fd);
+    }
+  }
+  else if (!stalled)
+  {
+    for (size_t i = 0; i < fillers.size(); i++)
+    {
+      close(fillers[i]);
+    }
+
+    fillers.clear();
+  }
+}
+
+void FakeVmix::closeAll()
+{
+  for (size_t i = 0; i < clients.size(); i++)
+  {
+    close(clients[i].fd);
+  }
+
+  clients.clear();
+}
+
+void FakeVmix::update()
+{
+  int fd;
+
+  while (!stalled && (fd = accept(listener, NULL, NULL)) >= 0)
+  {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    clients.push_back({fd, false, ""});
+    accepted++;
+  }
+
+  for (size_t i = 0; i < clients.size(); i++)
+  {
+    Client &client = clients[i];
+    char buffer[256];
+    ssize_t length;
+
+    while ((length = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+    {
+      client.input.append(buffer, length);
+    }
+
+    if (length == 0)
+    {
+      close(client.fd);
+      clients.erase(clients.begin() + i--);
+      continue;
+    }
+
+    size_t end;
+
+    while ((end = client.input.find("\r\n")) != std::string::npos)
+    {
+      std::string command = client.input.substr(0, end);
+      client.input.erase(0, end + 2);
+
+      if (silent)
+      {
+        continue;
+      }
+
+      if (command == "SUBSCRIBE TALLY")
+      {
+        client.subscribed = true;
+        send(client, "SUBSCRIBE OK TALLY\r\nTALLY OK " + tally + "\r\n");
+      }
+      else if (command == "TALLY")
+      {
+        send(client, "TALLY OK " + tally + "\r\n");
+      }
+      else if (command == "VERSION")
+      {
+        versions++;
+        send(client, "VERSION OK 27.0.0.49\r\n");
+      }
+    }
+  }
+}
+
+void FakeVmix::send(Client &client, const std::string &message)
+{
+  if (!silent)
+  {
+    ::send(client.fd, message.data(), message.size(), MSG_NOSIGNAL);
+  }
+}
@@ -0,0 +1,60 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  A vMix TCP API server on the loopback interface for the host tests, it does
+  its work when the test calls update()
+*/
+
+#ifndef FAKE_VMIX_H
+#define FAKE_VMIX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class FakeVmix
+{
+  public:
+    // Port 0 picks a free port, any 127.x.x.x address works on Linux
+    FakeVmix(const char *address = "127.0.0.1", uint16_t port = 0);
+    ~FakeVmix();
+
+    // Send a tally line to every subscriber, also the answer to TALLY from then on
+    void setTally(const char *tally);
+
+    // Stop answering without closing the connections, like a host that lost power
+    void setSilent(bool silent);
+
+    // Keep connections from completing, like a host that is up but swamped
+    void setStalled(bool stalled);
+
+    // Drop every connection
+    void closeAll();
+
+    // Accept connections and answer commands
+    void update();
+
+    uint16_t port;
+    unsigned long accepted;
+    unsigned long versions;
+
+  private:
+    struct Client
+    {
+      int fd;
+      bool subscribed;
+      std::string input;
+    };
+
+    void send(Client &client, const std::string &message);
+
+    int listener;
+    std::vector<int> fillers;
+    bool silent;
+    bool stalled;
+    std::string tally;
+    std::vector<Client> clients;
+};
+
+#endif
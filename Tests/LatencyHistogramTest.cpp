@@ -0,0 +1,87 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for the latency histogram
+*/
+
+#include "LatencyHistogram.h"
+#include "Check.h"
+
+void testEmpty()
+{
+  LatencyHistogram histogram;
+
+  CHECK(histogram.count == 0);
+  CHECK(histogram.percentile(50) == 0);
+}
+
+void testSmallValuesAreExact()
+{
+  LatencyHistogram histogram;
+
+  for (uint32_t value = 0; value < 8; value++)
+  {
+    histogram.record(value);
+  }
+
+  CHECK(histogram.count == 8);
+  CHECK(histogram.min == 0);
+  CHECK(histogram.max == 7);
+  CHECK(histogram.sum == 28);
+  CHECK(histogram.percentile(50) == 3);
+  CHECK(histogram.percentile(100) == 7);
+}
+
+void testPercentiles()
+{
+  LatencyHistogram histogram;
+
+  for (uint32_t value = 1; value <= 1000; value++)
+  {
+    histogram.record(value);
+  }
+
+  // Every bucket is at most 12.5% wide, and never above what was measured
+  uint32_t p50 = histogram.percentile(50);
+  uint32_t p99 = histogram.percentile(99);
+
+  CHECK(p50 >= 500 && p50 <= 500 * 9 / 8);
+  CHECK(p99 >= 990 && p99 <= 1000);
+  CHECK(histogram.percentile(100) == 1000);
+}
+
+void testOutOfRange()
+{
+  LatencyHistogram histogram;
+
+  histogram.record(LatencyMaxValue * 4);
+
+  CHECK(histogram.max == LatencyMaxValue * 4);
+  CHECK(histogram.percentile(50) <= LatencyMaxValue * 4);
+}
+
+void testReset()
+{
+  LatencyHistogram histogram;
+
+  histogram.record(100);
+  histogram.reset();
+  histogram.record(5);
+
+  CHECK(histogram.count == 1);
+  CHECK(histogram.min == 5);
+  CHECK(histogram.max == 5);
+  CHECK(histogram.percentile(50) == 5);
+}
+
+int main()
+{
+  testEmpty();
+  testSmallValuesAreExact();
+  testPercentiles();
+  testOutOfRange();
+  testReset();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,22 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  The LED matrix driver built as it is for the ESP8266, driving the pins through
+  the GPIO set and clear registers, renamed so it links next to the digitalWrite() build
+*/
+
+#define ESP8266
+#define MLED MLEDFast
+
+#include "WEMOS_Matrix_GFX.cpp"
+#include "MatrixScenario.h"
+
+#ifndef MLED_FAST_IO
+#error The ESP8266 build of the matrix driver should use MLED_FAST_IO
+#endif
+
+void playFastMatrixScenario()
+{
+  playMatrixScenario<MLEDFast>();
+}
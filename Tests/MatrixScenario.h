@@ -0,0 +1,41 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Frames, partial updates and intensity changes played through a build of the
+  LED matrix driver, so the pin writes of two builds can be compared
+*/
+
+#ifndef MATRIX_SCENARIO_H
+#define MATRIX_SCENARIO_H
+
+template <class Matrix>
+void playMatrixScenario()
+{
+  static const uint8_t frames[2][8] = {MLED_FRAME(0x00, 0x7E, 0xFF, 0x81, 0x81, 0xC3, 0x42, 0x00),
+                                       MLED_FRAME(0x18, 0x3C, 0x7E, 0xFF, 0x18, 0x18, 0x18, 0x18)};
+  Matrix matrix(4);
+
+  matrix.setFrame(frames[0]);
+  matrix.writeDisplay();
+
+  matrix.disBuffer[3] = 0x5A;
+  matrix.writeDisplay();
+
+  matrix.intensity = 7;
+  matrix.writeDisplay();
+
+  matrix.setFrame(frames[1]);
+  matrix.present();
+
+  while (!matrix.tick(2))
+  {
+  }
+
+  matrix.clear();
+  matrix.drawPixel(3, 4, LED_ON);
+  matrix.present();
+  matrix.tick(MLED_QUEUE_LENGTH);
+}
+
+#endif
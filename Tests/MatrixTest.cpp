@@ -0,0 +1,351 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for the bytes the LED matrix driver clocks out to the TM1640
+*/
+
+#include <utility>
+#include <vector>
+#include <WEMOS_Matrix_GFX.h>
+#include "Check.h"
+#include "MatrixScenario.h"
+
+typedef std::vector<uint8_t> Transfer;
+typedef std::vector<std::pair<uint8_t, uint8_t>> PinTrace;
+
+// Pin writes in order, to compare builds of the driver
+PinTrace pinTrace;
+
+// The scenario played through the driver built with MLED_FAST_IO, in MatrixFastIo.cpp
+void playFastMatrixScenario();
+
+// Decodes the TM1640 bus from the pin writes: start and stop are data edges while
+// the clock is high, data bits are read least significant first on the rising clock
+struct Bus
+{
+  uint8_t clock = HIGH;
+  uint8_t data = HIGH;
+  bool started = false;
+  int bits = 0;
+  uint8_t value = 0;
+  std::vector<Transfer> transfers;
+} bus;
+
+void handlePin(uint8_t pin, uint8_t value)
+{
+  pinTrace.push_back(std::make_pair(pin, value));
+
+  if (pin == D7)
+  {
+    if (bus.clock == HIGH && value != bus.data)
+    {
+      if (value == LOW)
+      {
+        bus.started = true;
+        bus.transfers.push_back(Transfer());
+      }
+      else
+      {
+        bus.started = false;
+      }
+
+      bus.bits = 0;
+    }
+
+    bus.data = value;
+  }
+  else if (pin == D5)
+  {
+    if (bus.started && bus.clock == LOW && value == HIGH)
+    {
+      bus.value = (bus.value >> 1) | (bus.data ? 0x80 : 0);
+
+      if (++bus.bits == 8)
+      {
+        bus.transfers.back().push_back(bus.value);
+        bus.bits = 0;
+      }
+    }
+
+    bus.clock = value;
+  }
+}
+
+// Send the drawing buffer and return the transfers it took
+std::vector<Transfer> show(MLED &matrix)
+{
+  bus.transfers.clear();
+  matrix.writeDisplay();
+  return bus.transfers;
+}
+
+bool isTransfer(const Transfer &transfer, const std::vector<uint8_t> &bytes)
+{
+  return transfer == bytes;
+}
+
+// The display RAM and control state of a TM1640, following the commands it is sent
+struct Tm1640
+{
+  uint8_t ram[16] = {0};
+  bool fixedAddress = false;
+  uint8_t address = 0;
+  bool on = false;
+  uint8_t brightness = 0;
+
+  void apply(const std::vector<Transfer> &transfers)
+  {
+    for (size_t i = 0; i < transfers.size(); i++)
+    {
+      const Transfer &transfer = transfers[i];
+
+      if (transfer.empty())
+      {
+        continue;
+      }
+
+      uint8_t command = transfer[0];
+
+      if ((command & 0xC0) == 0x40)
+      {
+        // Data command, only fixed or incrementing addresses matter to the display
+        fixedAddress = command & 0x04;
+      }
+      else if ((command & 0xC0) == 0xC0)
+      {
+        // Address command followed by the data
+        address = command & 0x0F;
+
+        for (size_t j = 1; j < transfer.size(); j++)
+        {
+          ram[address] = transfer[j];
+
+          if (!fixedAddress)
+          {
+            address = (address + 1) & 0x0F;
+          }
+        }
+      }
+      else if ((command & 0xC0) == 0x80)
+      {
+        on = command & 0x08;
+        brightness = command & 0x07;
+      }
+    }
+  }
+};
+
+// The driver as it wrote a frame before the auto-increment transfer: every row with
+// its own fixed-address transfer, then the display control command
+class FixedAddressMatrix : public MLED
+{
+  public:
+    FixedAddressMatrix(uint8_t intensity) : MLED(intensity) {}
+
+    void writeDisplay()
+    {
+      for (uint8_t i = 0; i < 8; i++)
+      {
+        sendData(i, disBuffer[i]);
+      }
+
+      sendCommand(0x88 | intensity);
+    }
+};
+
+static const uint8_t Frame[8] = MLED_FRAME(0x00, 0x7E, 0xFF, 0x81, 0x81, 0xC3, 0x42, 0x00);
+
+void testFirstFrame()
+{
+  MLED matrix(4);
+  matrix.setFrame(Frame);
+
+  std::vector<Transfer> transfers = show(matrix);
+
+  // Auto-increment mode, all rows from address 0, then the display on with the intensity
+  CHECK(transfers.size() == 3);
+  CHECK(isTransfer(transfers[0], {0x40}));
+  CHECK(isTransfer(transfers[1], {0xC0, Frame[0], Frame[1], Frame[2], Frame[3], Frame[4], Frame[5], Frame[6], Frame[7]}));
+  CHECK(isTransfer(transfers[2], {0x8C}));
+  CHECK(matrix.rowsSent == 8);
+}
+
+void testChangedRows()
+{
+  MLED matrix(4);
+  matrix.setFrame(Frame);
+  show(matrix);
+
+  // Only the rows from the first to the last change are sent
+  matrix.disBuffer[2] = 0x11;
+  matrix.disBuffer[5] = 0x22;
+  std::vector<Transfer> transfers = show(matrix);
+
+  CHECK(transfers.size() == 2);
+  CHECK(isTransfer(transfers[0], {0x40}));
+  CHECK(isTransfer(transfers[1], {0xC2, 0x11, Frame[3], Frame[4], 0x22}));
+  CHECK(matrix.rowsSent == 12);
+  CHECK(matrix.rowsSkipped == 4);
+
+  // Nothing is sent for the frame the chip already shows
+  CHECK(show(matrix).empty());
+  CHECK(matrix.rowsSkipped == 12);
+
+  matrix.intensity = 7;
+  transfers = show(matrix);
+
+  CHECK(transfers.size() == 1);
+  CHECK(isTransfer(transfers[0], {0x8F}));
+}
+
+void testTick()
+{
+  MLED matrix(4);
+  bus.transfers.clear();
+  matrix.setFrame(Frame);
+  matrix.present();
+
+  // The eleven bytes of a full frame go out two per call
+  int calls = 1;
+
+  while (!matrix.tick(2))
+  {
+    calls++;
+  }
+
+  CHECK(calls == 6);
+  CHECK(!matrix.busy());
+  CHECK(!matrix.tick(2));
+
+  // A frame presented during a transfer waits for it, rows never mix two frames
+  matrix.disBuffer[0] = 0x01;
+  matrix.present();
+  matrix.tick(1);
+  matrix.disBuffer[0] = 0x02;
+  matrix.present();
+
+  while (matrix.busy())
+  {
+    matrix.tick(1);
+  }
+
+  CHECK(bus.transfers.size() == 7);
+  CHECK(isTransfer(bus.transfers[4], {0xC0, 0x01}));
+  CHECK(isTransfer(bus.transfers[6], {0xC0, 0x02}));
+
+  // A whole frame fits in one call
+  for (int i = 0; i < 8; i++)
+  {
+    matrix.disBuffer[i] = ~Frame[i];
+  }
+
+  matrix.intensity = 1;
+  matrix.present();
+  CHECK(matrix.tick(MLED_QUEUE_LENGTH));
+  CHECK(!matrix.busy());
+  CHECK(bus.transfers.size() == 10);
+}
+
+void testFrameMacro()
+{
+  static const uint8_t rows[8] = {0x00, 0x7E, 0xFF, 0x81, 0x81, 0xC3, 0x42, 0x00};
+  MLED matrix(4);
+
+  // MLED_FRAME() builds what drawBitmap() draws
+  matrix.clear();
+  matrix.drawBitmap(0, 0, rows, 8, 8, LED_ON);
+
+  CHECK(memcmp(matrix.disBuffer, Frame, sizeof(Frame)) == 0);
+}
+
+// The chip ends up with the same display RAM and control state as with the fixed-address writes
+void testDisplayRam()
+{
+  MLED matrix(4);
+  FixedAddressMatrix fixed(4);
+  Tm1640 chip;
+  Tm1640 fixedChip;
+  unsigned long writes = 0;
+  unsigned long fixedWrites = 0;
+
+  srand(1);
+
+  for (int step = 0; step < 64; step++)
+  {
+    if (step == 0)
+    {
+      matrix.setFrame(Frame);
+    }
+    else if (step % 8 == 0)
+    {
+      matrix.intensity = rand() % 8;
+    }
+    else
+    {
+      // Change a few rows, sometimes none
+      for (int i = rand() % 4; i > 0; i--)
+      {
+        matrix.disBuffer[rand() % 8] = rand();
+      }
+    }
+
+    memcpy(fixed.disBuffer, matrix.disBuffer, sizeof(matrix.disBuffer));
+    fixed.intensity = matrix.intensity;
+
+    pinTrace.clear();
+    chip.apply(show(matrix));
+    writes += pinTrace.size();
+
+    pinTrace.clear();
+    bus.transfers.clear();
+    fixed.writeDisplay();
+    fixedChip.apply(bus.transfers);
+    fixedWrites += pinTrace.size();
+
+    CHECK(memcmp(chip.ram, fixedChip.ram, sizeof(chip.ram)) == 0);
+    CHECK(memcmp(chip.ram, matrix.disBuffer, sizeof(matrix.disBuffer)) == 0);
+    CHECK(chip.on && fixedChip.on);
+    CHECK(chip.brightness == fixedChip.brightness);
+    CHECK(chip.brightness == matrix.intensity);
+  }
+
+  // Skipping unchanged rows and commands takes far fewer pin writes
+  CHECK(writes * 4 < fixedWrites);
+}
+
+void testFastIo()
+{
+  PinTrace slow;
+  unsigned long start;
+
+  pinTrace.clear();
+  playMatrixScenario<MLED>();
+  slow = pinTrace;
+
+  // The GPIO registers drive the pins in the same order to the same levels as digitalWrite()
+  hostSetMicros(0);
+  pinTrace.clear();
+  start = micros();
+  playFastMatrixScenario();
+
+  CHECK(slow.size() > 500);
+  CHECK(pinTrace == slow);
+
+  // Holding every level for MLED_EDGE_CYCLES at 80 MHz
+  CHECK(micros() - start >= pinTrace.size() * (F_CPU / 2000000) / 80);
+}
+
+int main()
+{
+  hostOnDigitalWrite(handlePin);
+
+  testFirstFrame();
+  testChangedRows();
+  testTick();
+  testFrameMacro();
+  testDisplayRam();
+  testFastIo();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,150 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Benchmark of the settings page streamed from its template against the page built
+  as one String, the way rootPageHandler() did before. Fails when the streamed page
+  needs a heap block of the size of the page.
+*/
+
+#include <string>
+#include <vector>
+#include "Arduino-vMix-Tally.ino.cpp"
+#include "AllocationCounter.h"
+
+const int Pages = 1000;
+
+// A line of the template split at its placeholders, literals has one more entry than names
+struct TemplateLine
+{
+  std::vector<std::string> literals;
+  std::vector<std::string> names;
+};
+
+std::vector<TemplateLine> templateLines;
+
+void splitTemplate()
+{
+  std::string page = rootPageTemplate;
+  size_t start = 0;
+
+  while (start < page.size())
+  {
+    size_t end = page.find('\n', start);
+    std::string text = page.substr(start, end == std::string::npos ? std::string::npos : end + 1 - start);
+    TemplateLine line;
+    size_t open;
+
+    while ((open = text.find("{{")) != std::string::npos)
+    {
+      size_t close = text.find("}}", open);
+
+      line.literals.push_back(text.substr(0, open));
+      line.names.push_back(text.substr(open + 2, close - open - 2));
+      text.erase(0, close + 2);
+    }
+
+    line.literals.push_back(text);
+    templateLines.push_back(line);
+    start = end == std::string::npos ? page.size() : end + 1;
+  }
+}
+
+// The value of a placeholder as the sketch formats it
+const char *placeholderValue(const char *name)
+{
+  chunkLength = 0;
+  printPlaceholder(name);
+  chunkBuffer[chunkLength] = '\0';
+  chunkLength = 0;
+
+  return chunkBuffer;
+}
+
+// The same page built the way rootPageHandler() did before it streamed a template: one
+// String grown by an append per line, with temporary Strings around every value
+void stringRootPageHandler()
+{
+  String page;
+
+  for (size_t i = 0; i < templateLines.size(); i++)
+  {
+    const TemplateLine &line = templateLines[i];
+
+    if (line.names.empty())
+    {
+      page += line.literals[0].c_str();
+      continue;
+    }
+
+    String text = line.literals[0].c_str();
+
+    for (size_t j = 0; j < line.names.size(); j++)
+    {
+      text += String(placeholderValue(line.names[j].c_str())) + line.literals[j + 1].c_str();
+    }
+
+    page += text;
+  }
+
+  httpServer.sendHeader("Connection", "close");
+  httpServer.send(200, "text/html", String(page));
+}
+
+// Serve the page many times and print what one page cost, returns the largest heap block
+size_t benchmarkPage(const char *name, const char *uri)
+{
+  unsigned long allocations = hostAllocations;
+  unsigned long firstByte = 0;
+  unsigned long lastByte = 0;
+
+  hostLargestAllocation = 0;
+
+  for (int i = 0; i < Pages; i++)
+  {
+    unsigned long start = micros();
+
+    httpServer.hostRequest(HTTP_GET, uri);
+    firstByte += httpServer.response.firstByteAt - start;
+    lastByte += httpServer.response.lastByteAt - start;
+  }
+
+  printf("%-16s %8zu %8lu %8lu %8zu %10.1f %10.1f\n", name, httpServer.response.length, httpServer.response.writes,
+         (hostAllocations - allocations) / Pages, hostLargestAllocation, (double)firstByte / Pages, (double)lastByte / Pages);
+
+  return hostLargestAllocation;
+}
+
+int main()
+{
+  bool same;
+
+  EEPROM.hostErase();
+  setup();
+  httpServer.on("/strings", HTTP_GET, stringRootPageHandler);
+  splitTemplate();
+
+  // Both ways give the same page
+  httpServer.hostRequest(HTTP_GET, "/");
+  String streamed = httpServer.response.body;
+  httpServer.hostRequest(HTTP_GET, "/strings");
+  same = streamed == httpServer.response.body;
+
+  httpServer.hostKeepBody = false;
+
+  printf("%-16s %8s %8s %8s %8s %10s %10s\n", "Page", "bytes", "writes", "allocs", "largest", "first us", "last us");
+  benchmarkPage("String", "/strings");
+  size_t largest = benchmarkPage("Template", "/");
+
+  if (!same)
+  {
+    printf("The pages differ\n");
+  }
+
+  if (largest >= sizeof(chunkBuffer))
+  {
+    printf("The streamed page allocated %zu bytes at once\n", largest);
+  }
+
+  return same && largest < sizeof(chunkBuffer) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for the loop() scheduler, against a clock that only moves when a task runs
+*/
+
+#include <Arduino.h>
+#include "Scheduler.h"
+#include "Check.h"
+
+// Time each task takes when it runs, in microseconds
+unsigned long firstTime = 0;
+unsigned long secondTime = 0;
+unsigned long thirdTime = 0;
+
+void firstTask()
+{
+  hostAdvanceMicros(firstTime);
+}
+
+void secondTask()
+{
+  hostAdvanceMicros(secondTime);
+}
+
+void thirdTask()
+{
+  hostAdvanceMicros(thirdTime);
+}
+
+void testAllTasksRun()
+{
+  Scheduler scheduler(10000);
+  hostSetMicros(0);
+  firstTime = 1000;
+  secondTime = 500;
+  thirdTime = 200;
+
+  CHECK(scheduler.add("first", firstTask, 2000));
+  CHECK(scheduler.add("second", secondTask, 1000));
+  CHECK(scheduler.add("third", thirdTask, 1000));
+
+  scheduler.run();
+  scheduler.run();
+
+  CHECK(scheduler.frames == 2);
+  CHECK(scheduler.frameMisses == 0);
+  CHECK(scheduler.tasks[0].runs == 2);
+  CHECK(scheduler.tasks[1].runs == 2);
+  CHECK(scheduler.tasks[2].runs == 2);
+  CHECK(scheduler.tasks[0].runtime == 2000);
+  CHECK(scheduler.tasks[0].maxRuntime == 1000);
+  CHECK(scheduler.tasks[0].misses == 0);
+}
+
+void testDeferral()
+{
+  Scheduler scheduler(10000);
+  hostSetMicros(0);
+  firstTime = 9500;
+  secondTime = 100;
+
+  scheduler.add("first", firstTask, 2000);
+  scheduler.add("second", secondTask, 1000);
+
+  // The first task overran, the second no longer fits and waits for the next pass
+  scheduler.run();
+
+  CHECK(scheduler.tasks[0].runs == 1);
+  CHECK(scheduler.tasks[0].misses == 1);
+  CHECK(scheduler.tasks[1].runs == 0);
+  CHECK(scheduler.tasks[1].deferred == 1);
+
+  // It is never deferred more than SchedulerMaxDeferrals times in a row
+  for (int i = 0; i < SchedulerMaxDeferrals; i++)
+  {
+    scheduler.run();
+  }
+
+  CHECK(scheduler.tasks[1].deferred == SchedulerMaxDeferrals);
+  CHECK(scheduler.tasks[1].runs == 1);
+  CHECK(scheduler.tasks[0].runs == SchedulerMaxDeferrals + 1);
+}
+
+void testFrameMiss()
+{
+  Scheduler scheduler(10000);
+  hostSetMicros(0);
+  firstTime = 11000;
+
+  // The first task always runs, even when it alone breaks the frame
+  scheduler.add("first", firstTask, 20000);
+  scheduler.run();
+
+  CHECK(scheduler.tasks[0].runs == 1);
+  CHECK(scheduler.tasks[0].misses == 0);
+  CHECK(scheduler.frameMisses == 1);
+
+  scheduler.reset();
+  CHECK(scheduler.frames == 0);
+  CHECK(scheduler.tasks[0].runs == 0);
+}
+
+void testTaskLimit()
+{
+  Scheduler scheduler(10000);
+
+  for (int i = 0; i < SchedulerTasksMaxValue; i++)
+  {
+    CHECK(scheduler.add("task", firstTask, 100));
+  }
+
+  CHECK(!scheduler.add("task", firstTask, 100));
+}
+
+int main()
+{
+  testAllTasksRun();
+  testDeferral();
+  testFrameMiss();
+  testTaskLimit();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,164 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for the settings stored in EEPROM
+*/
+
+#include "Arduino-vMix-Tally.ino.cpp"
+#include "Check.h"
+
+// Settings compare equal when they store the same bytes
+bool sameSettings(const Settings &a, const Settings &b)
+{
+  Settings packedA;
+  Settings packedB;
+
+  packSettings(packedA, a);
+  packSettings(packedB, b);
+
+  return memcmp(&packedA, &packedB, sizeof(Settings)) == 0;
+}
+
+// Write settings the way firmware before the settings record did, byte by byte
+void writeLegacySettings(const char *ssid, const char *pass, const char *hostName, uint8_t tallyNumber)
+{
+  EEPROM.hostErase();
+  strncpy((char *)EEPROM.data, ssid, SsidMaxLength);
+  strncpy((char *)EEPROM.data + SsidMaxLength, pass, PassMaxLength);
+  strncpy((char *)EEPROM.data + SsidMaxLength + PassMaxLength, hostName, HostNameMaxLength);
+  EEPROM.data[SsidMaxLength + PassMaxLength + HostNameMaxLength] = tallyNumber;
+}
+
+SettingsRecord storedRecord()
+{
+  SettingsRecord record;
+
+  return EEPROM.get(SettingsAddress, record);
+}
+
+void testErased()
+{
+  EEPROM.hostErase();
+  settings.tallyNumber = 99;
+
+  loadSettings();
+
+  // Erased flash gets the defaults, stored right away
+  CHECK(sameSettings(settings, defaultSettings));
+  CHECK(EEPROM.commits == 1);
+  CHECK(storedRecord().magic == SettingsMagic);
+  CHECK(storedRecord().version == SettingsVersion);
+  CHECK(storedRecord().crc == settingsCrc(storedRecord().settings));
+}
+
+void testRoundTrip()
+{
+  Settings saved;
+
+  EEPROM.hostErase();
+  loadSettings();
+
+  strcpy(settings.ssid, "studio");
+  strcpy(settings.backupHostName, "vmix-backup");
+  settings.tallyNumber = 12;
+  settings.tallyMode = TallyModeActs;
+  settings.extraInputs[0] = 14;
+  settings.heartbeatMisses = 1;
+  settings.hostPolicy = HostPolicyLive;
+  saveSettings();
+  saved = settings;
+
+  settings = defaultSettings;
+  loadSettings();
+  CHECK(sameSettings(settings, saved));
+  CHECK(EEPROM.commits == 2);
+
+  // Unchanged settings are not written to flash again, whatever follows the string terminators
+  memset(settings.ssid + strlen(settings.ssid) + 1, 'x', 10);
+  saveSettings();
+  CHECK(EEPROM.commits == 2);
+}
+
+void testWifiCacheKept()
+{
+  WifiCache cache;
+
+  EEPROM.hostErase();
+  memset(&cache, 0, sizeof(cache));
+  cache.magic = WifiCacheMagic;
+  cache.channel = 11;
+  EEPROM.put(WifiCacheAddress, cache);
+
+  loadSettings();
+  strcpy(settings.hostName, "a long vMix host name that fills most of the field of 64 chars");
+  saveSettings();
+
+  CHECK(memcmp(EEPROM.data + WifiCacheAddress, &cache, sizeof(cache)) == 0);
+}
+
+void testLegacy()
+{
+  writeLegacySettings("studio", "secret", "vmix", 7);
+
+  loadSettings();
+
+  // Fields that earlier firmware did not have get their default
+  CHECK(strcmp(settings.ssid, "studio") == 0);
+  CHECK(strcmp(settings.pass, "secret") == 0);
+  CHECK(strcmp(settings.hostName, "vmix") == 0);
+  CHECK(settings.tallyNumber == 7);
+  CHECK(settings.heartbeatMisses == defaultSettings.heartbeatMisses);
+  CHECK(strcmp(settings.backupHostName, defaultSettings.backupHostName) == 0);
+
+  // Migrated to a record
+  CHECK(storedRecord().magic == SettingsMagic);
+  CHECK(storedRecord().version == SettingsVersion);
+  CHECK(EEPROM.commits == 1);
+}
+
+void testLegacyLooksLikeRecord()
+{
+  // An SSID starting with "TV" stores the magic of a record in its first bytes
+  writeLegacySettings("TVstudio", "secret", "vmix", 3);
+
+  loadSettings();
+
+  CHECK(strcmp(settings.ssid, "TVstudio") == 0);
+  CHECK(settings.tallyNumber == 3);
+  CHECK(storedRecord().version == SettingsVersion);
+}
+
+void testCorrupted()
+{
+  EEPROM.hostErase();
+  loadSettings();
+  strcpy(settings.ssid, "studio");
+  saveSettings();
+
+  // A record with a bad CRC is not trusted, the defaults are stored over it
+  EEPROM.data[SettingsAddress + offsetof(SettingsRecord, settings) + 1] ^= 0x01;
+  loadSettings();
+  CHECK(sameSettings(settings, defaultSettings));
+  CHECK(storedRecord().crc == settingsCrc(storedRecord().settings));
+
+  // So is a record of an unknown version
+  SettingsRecord record = storedRecord();
+  record.version = SettingsVersion + 1;
+  EEPROM.put(SettingsAddress, record);
+  strcpy(settings.ssid, "changed");
+  loadSettings();
+  CHECK(sameSettings(settings, defaultSettings));
+}
+
+int main()
+{
+  testErased();
+  testRoundTrip();
+  testWifiCacheKept();
+  testLegacy();
+  testLegacyLooksLikeRecord();
+  testCorrupted();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,30 @@
+# Turns the sketch into C++ the way the Arduino IDE does: Arduino.h is included and every
+# function is declared before the first function definition, so it can be called from
+# anywhere in the sketch. Run with cmake -DSKETCH=<ino> -DOUTPUT=<cpp> -P Sketch.cmake
+
+file(READ "${SKETCH}" source)
+
+# A function definition starts in the first column and has its brace on the next line
+set(definition "\n[A-Za-z_][A-Za-z0-9_:<> *]*[ *][A-Za-z_][A-Za-z0-9_]*\\([^;{}\n]*\\)\n{")
+string(REGEX MATCHALL "${definition}" headers "${source}")
+string(REGEX MATCH "${definition}" first "${source}")
+string(FIND "${source}" "${first}" split)
+
+set(prototypes "")
+
+foreach(header ${headers})
+  string(REGEX REPLACE "^\n(.*)\n{$" "\\1" header "${header}")
+  # Default arguments only go in the declaration
+  string(REGEX REPLACE " *=[^,)]*" "" header "${header}")
+  string(APPEND prototypes "${header};\n")
+endforeach()
+
+string(SUBSTRING "${source}" 0 ${split} head)
+string(SUBSTRING "${source}" ${split} -1 tail)
+
+# Keep compiler messages pointing at the lines of the sketch
+string(REGEX MATCHALL "\n" lines "${head}")
+list(LENGTH lines line)
+math(EXPR line "${line} + 2")
+
+file(WRITE "${OUTPUT}" "#include <Arduino.h>\n#line 1 \"${SKETCH}\"\n${head}\n${prototypes}#line ${line} \"${SKETCH}\"${tail}")
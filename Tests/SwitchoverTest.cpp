@@ -0,0 +1,125 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for switching over to the backup vMix host, with two simulated hosts
+*/
+
+#include "Arduino-vMix-Tally.ino.cpp"
+#include "Check.h"
+#include "FakeVmix.h"
+
+FakeVmix primary("127.0.0.1");
+FakeVmix backup("127.0.0.2", primary.port);
+
+// Runs both hosts and the tally for the given time, one millisecond per step
+void run(unsigned long time)
+{
+  for (unsigned long i = 0; i < time; i++)
+  {
+    primary.update();
+    backup.update();
+    loop();
+    hostAdvanceMicros(1000);
+  }
+}
+
+// Runs until the LED shows the backup host, returns the time that took in microseconds
+unsigned long runUntilBackup()
+{
+  unsigned long start = micros();
+
+  for (int i = 0; i < 5000 && (following != &vmixBackup || currentState != '2' || latencyPending); i++)
+  {
+    run(1);
+  }
+
+  return micros() - start;
+}
+
+// Follow the primary host again, after it is back
+void followPrimary()
+{
+  primary.setSilent(false);
+  run(BackoffMinDelay + 500);
+  CHECK(following == &vmix);
+  CHECK(currentState == '1');
+}
+
+void connectHosts()
+{
+  Settings previous;
+
+  // Both hosts listen on the same port, like two vMix machines
+  port = primary.port;
+  primary.setTally("1");
+  backup.setTally("2");
+
+  hostSetMicros(1000000);
+  EEPROM.hostErase();
+  setup();
+  run(3000);
+
+  previous = settings;
+  strcpy(settings.hostName, "127.0.0.1");
+  strcpy(settings.backupHostName, "127.0.0.2");
+  applySettings(previous);
+  run(500);
+
+  CHECK(vmix.connected());
+  CHECK(vmixBackup.connected());
+  CHECK(following == &vmix);
+  CHECK(currentState == '1');
+}
+
+void testSilent(uint8_t misses)
+{
+  Settings previous = settings;
+
+  settings.heartbeatMisses = misses;
+  applySettings(previous);
+  run(1000);
+  switchoverTime.reset();
+
+  // The primary stops answering without closing the connection
+  primary.setSilent(true);
+  unsigned long time = runUntilBackup();
+
+  CHECK(following == &vmixBackup);
+  CHECK(currentState == '2');
+  CHECK(vmix.heartbeatTimeouts > 0);
+
+  // Counted from the last data the primary sent, so up to one heartbeat before it went silent
+  CHECK(switchoverTime.count == 1);
+  CHECK(switchoverTime.max <= (misses + 1) * HeartbeatInterval * 1000 + 5000);
+  CHECK(time <= switchoverTime.max);
+  CHECK(switchoverTime.max < 1000000);
+
+  followPrimary();
+}
+
+void testClosed()
+{
+  switchoverTime.reset();
+
+  // A host that closes the connection is left straight away
+  primary.closeAll();
+  unsigned long time = runUntilBackup();
+
+  CHECK(following == &vmixBackup);
+  CHECK(switchoverTime.count == 1);
+  CHECK(switchoverTime.max < 10000);
+  CHECK(time < 10000);
+
+  followPrimary();
+}
+
+int main()
+{
+  connectHosts();
+  testSilent(defaultSettings.heartbeatMisses);
+  testSilent(1);
+  testClosed();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,157 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Benchmark of the vMix data parser with short and long tally lines, run it under perf
+  to profile. Fails when feeding the parser allocates memory.
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AllocationCounter.h"
+#include "TallyParser.h"
+
+const int Lines = 20000;
+const int ReadLength = 128;
+
+char lines[Lines][TallyMaxLength + 12];
+int lineLengths[Lines];
+int lineInputs;
+bool allocated = false;
+
+void handleResponse(const char *response)
+{
+}
+
+// Every line of the given number of inputs cuts one random input to program and another to preview
+void makeLines(int inputs)
+{
+  char tally[TallyMaxLength];
+  srand(1);
+  memset(tally, '0', inputs);
+  lineInputs = inputs;
+
+  for (int i = 0; i < Lines; i++)
+  {
+    char *program = (char *)memchr(tally, '1', inputs);
+    char *preview = (char *)memchr(tally, '2', inputs);
+
+    if (program != NULL)
+    {
+      *program = '0';
+    }
+
+    if (preview != NULL)
+    {
+      *preview = '0';
+    }
+
+    tally[rand() % inputs] = '2';
+    tally[rand() % inputs] = '1';
+
+    memcpy(lines[i], "TALLY OK ", 9);
+    memcpy(lines[i] + 9, tally, inputs);
+    memcpy(lines[i] + 9 + inputs, "\r\n", 2);
+    lineLengths[i] = 9 + inputs + 2;
+  }
+}
+
+double now()
+{
+  using namespace std::chrono;
+  return duration_cast<duration<double, std::nano>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Feed the lines the way VmixConnection reads them, linesPerRead lines at a time
+void benchmarkFeed(const char *name, int linesPerRead, bool changes)
+{
+  TallyParser parser(handleResponse);
+  uint16_t inputs[] = {1, (uint16_t)(lineInputs / 10), (uint16_t)(lineInputs / 2), (uint16_t)(lineInputs - 1), (uint16_t)lineInputs};
+  const uint16_t *changed;
+  unsigned long shown = 0;
+  char state;
+
+  parser.setInputs(inputs, 5, 0xFF);
+
+  unsigned long allocations = hostAllocations;
+  double start = now();
+
+  for (int i = 0; i < Lines; i += linesPerRead)
+  {
+    for (int j = i; j < i + linesPerRead && j < Lines; j++)
+    {
+      for (int offset = 0; offset < lineLengths[j]; offset += ReadLength)
+      {
+        int length = lineLengths[j] - offset < ReadLength ? lineLengths[j] - offset : ReadLength;
+        parser.feed((const uint8_t *)lines[j] + offset, length);
+      }
+    }
+
+    shown += parser.takeState(state);
+
+    if (changes)
+    {
+      parser.takeChanges(changed);
+    }
+  }
+
+  double elapsed = now() - start;
+  allocations = hostAllocations - allocations;
+  allocated = allocated || allocations > 0;
+
+  printf("%-24s %6d %10.0f %10lu %10lu %8lu\n", name, lineInputs, elapsed / Lines, parser.states, shown, allocations);
+}
+
+void benchmarkActs()
+{
+  TallyParser parser(handleResponse);
+  uint16_t inputs[] = {3};
+  static const char *events[] = {"ACTS OK Input 3 1\r\n", "ACTS OK Input 7 1\r\n", "ACTS OK InputPreview 3 0\r\n",
+                                 "ACTS OK Overlay1 12 1\r\n"};
+  char state;
+
+  parser.setInputs(inputs, 1, 0xFF);
+
+  unsigned long allocations = hostAllocations;
+  double start = now();
+
+  for (int i = 0; i < Lines * 10; i++)
+  {
+    const char *event = events[i & 3];
+    parser.feed((const uint8_t *)event, strlen(event));
+    parser.takeState(state);
+  }
+
+  double elapsed = now() - start;
+  allocations = hostAllocations - allocations;
+  allocated = allocated || allocations > 0;
+
+  printf("%-24s %6s %10.0f %10lu %10s %8lu\n", "ACTS events", "-", elapsed / (Lines * 10), parser.states, "-", allocations);
+}
+
+int main()
+{
+  // Small productions send short lines, where the cost per line matters more than per input
+  static const int inputCounts[] = {8, 16, 32, 64, TallyMaxLength};
+
+  printf("%-24s %6s %10s %10s %10s %8s\n", "Benchmark", "inputs", "ns/line", "states", "shown", "allocs");
+
+  for (size_t i = 0; i < sizeof(inputCounts) / sizeof(inputCounts[0]); i++)
+  {
+    makeLines(inputCounts[i]);
+    benchmarkFeed("Tally lines", 1, false);
+    benchmarkFeed("Tally lines, changes", 1, true);
+    benchmarkFeed("Bursts of 10 lines", 10, false);
+  }
+
+  benchmarkActs();
+
+  if (allocated)
+  {
+    printf("The parser allocated memory\n");
+  }
+
+  return allocated ? 1 : 0;
+}
@@ -0,0 +1,286 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for the vMix data parser
+*/
+
+#include <string.h>
+#include "TallyParser.h"
+#include "Check.h"
+
+char lastResponse[ResponseMaxLength];
+int responses = 0;
+
+void handleResponse(const char *response)
+{
+  strncpy(lastResponse, response, sizeof(lastResponse) - 1);
+  responses++;
+}
+
+void feed(TallyParser &parser, const char *data)
+{
+  parser.feed((const uint8_t *)data, strlen(data));
+}
+
+// The newest state, or 'x' when there was none
+char takeState(TallyParser &parser)
+{
+  char state;
+
+  return parser.takeState(state) ? state : 'x';
+}
+
+void follow(TallyParser &parser, uint16_t input, uint8_t overlayMask = 0xFF)
+{
+  parser.setInputs(&input, 1, overlayMask);
+}
+
+void testTallyStates()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 3);
+
+  feed(parser, "TALLY OK 0010000\r\n");
+  CHECK(takeState(parser) == '1');
+
+  feed(parser, "TALLY OK 0020000\r\n");
+  CHECK(takeState(parser) == '2');
+
+  feed(parser, "TALLY OK 1200000\r\n");
+  CHECK(takeState(parser) == '0');
+  CHECK(takeState(parser) == 'x');
+  CHECK(parser.messages == 3);
+}
+
+void testStateBeforeLineEnd()
+{
+  TallyParser parser(handleResponse);
+  const char *line = "TALLY OK 0010000";
+  follow(parser, 3);
+
+  // The state is known once the digit of the input arrived, not at the end of the line
+  for (int i = 0; line[i]; i++)
+  {
+    parser.feed(line[i]);
+    CHECK(takeState(parser) == (i == 11 ? '1' : 'x'));
+  }
+
+  feed(parser, "\r\n");
+  CHECK(takeState(parser) == 'x');
+}
+
+void testSplitLines()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 2);
+
+  feed(parser, "TAL");
+  feed(parser, "LY OK 0");
+  CHECK(takeState(parser) == 'x');
+  feed(parser, "2\r");
+  CHECK(takeState(parser) == '2');
+  feed(parser, "\nTALLY OK 01\r\n");
+  CHECK(takeState(parser) == '1');
+}
+
+void testInputBeyondLine()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 10);
+
+  // Inputs the line does not reach are not in use
+  feed(parser, "TALLY OK 111\r\n");
+  CHECK(takeState(parser) == '0');
+}
+
+void testCoalescing()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 1);
+
+  // A burst read at once only reports the newest state, the others are counted
+  feed(parser, "TALLY OK 1\r\nTALLY OK 2\r\nTALLY OK 0\r\nTALLY OK 2\r\n");
+  CHECK(parser.states == 4);
+  CHECK(takeState(parser) == '2');
+  CHECK(takeState(parser) == 'x');
+}
+
+void testMultipleInputs()
+{
+  TallyParser parser(handleResponse);
+  uint16_t inputs[] = {2, 5, 7};
+  parser.setInputs(inputs, 3, 0xFF);
+
+  feed(parser, "TALLY OK 0000200\r\n");
+  CHECK(takeState(parser) == '2');
+
+  // Program wins over preview
+  feed(parser, "TALLY OK 0200001\r\n");
+  CHECK(takeState(parser) == '1');
+
+  feed(parser, "TALLY OK 1001010\r\n");
+  CHECK(takeState(parser) == '0');
+}
+
+void testSetInputsUsesLastLine()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 1);
+
+  feed(parser, "TALLY OK 0120\r\n");
+  CHECK(takeState(parser) == '0');
+
+  follow(parser, 2);
+  CHECK(takeState(parser) == '1');
+
+  follow(parser, 3);
+  CHECK(takeState(parser) == '2');
+}
+
+void testResponses()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 1);
+  responses = 0;
+
+  feed(parser, "SUBSCRIBE OK TALLY\r\n");
+  CHECK(responses == 1);
+  CHECK(strcmp(lastResponse, "SUBSCRIBE OK TALLY") == 0);
+
+  // Heartbeat replies are counted, not handed on
+  feed(parser, "VERSION OK 23.0.0.31\r\n");
+  CHECK(responses == 1);
+  CHECK(parser.versions == 1);
+  CHECK(takeState(parser) == 'x');
+
+  // Empty lines are ignored
+  feed(parser, "\r\n\r\n");
+  CHECK(responses == 1);
+}
+
+void testActs()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 4, 0x01);
+
+  feed(parser, "TALLY OK 0000\r\n");
+  CHECK(takeState(parser) == '0');
+
+  feed(parser, "ACTS OK InputPreview 4 1\r\n");
+  CHECK(takeState(parser) == '2');
+
+  feed(parser, "ACTS OK Input 4 1\r\n");
+  CHECK(takeState(parser) == '1');
+
+  feed(parser, "ACTS OK Input 4 0\r\nACTS OK InputPreview 4 0\r\n");
+  CHECK(takeState(parser) == '0');
+
+  // Events of other inputs are ignored
+  feed(parser, "ACTS OK Input 14 1\r\n");
+  CHECK(takeState(parser) == 'x');
+  CHECK(parser.activators == 5);
+
+  // Only the selected overlay channels count as program
+  feed(parser, "ACTS OK Overlay2 4 1\r\n");
+  CHECK(takeState(parser) == '0');
+
+  feed(parser, "ACTS OK Overlay1 4 1\r\n");
+  CHECK(takeState(parser) == '1');
+
+  feed(parser, "ACTS OK Overlay1 4 0\r\n");
+  CHECK(takeState(parser) == '0');
+  CHECK(!parser.takeQuery());
+}
+
+void testActsSeedOnOverlay()
+{
+  TallyParser parser(handleResponse);
+  follow(parser, 2, 0x01);
+
+  // The first tally line does not tell whether the input is on program or on an overlay
+  feed(parser, "TALLY OK 01\r\n");
+  CHECK(takeState(parser) == '1');
+
+  // It stays on program until a new tally line answers
+  feed(parser, "ACTS OK Overlay1 2 0\r\n");
+  CHECK(takeState(parser) == '1');
+  CHECK(parser.takeQuery());
+  CHECK(!parser.takeQuery());
+
+  feed(parser, "TALLY OK 00\r\n");
+  CHECK(takeState(parser) == '0');
+
+  // Once activator events explained an input the overlay mask applies to it
+  feed(parser, "ACTS OK Overlay3 2 1\r\n");
+  CHECK(takeState(parser) == '0');
+  feed(parser, "TALLY OK 01\r\n");
+  CHECK(takeState(parser) == '0');
+  CHECK(!parser.takeQuery());
+}
+
+void testChanges()
+{
+  TallyParser parser(handleResponse);
+  const uint16_t *inputs;
+  char line[TallyMaxLength + 16];
+  follow(parser, 1);
+
+  // The first line reports every input that is not off
+  strcpy(line, "TALLY OK ");
+  memset(line + 9, '0', 100);
+  line[9 + 2] = '1';
+  line[9 + 40] = '2';
+  strcpy(line + 9 + 100, "\r\n");
+  feed(parser, line);
+
+  CHECK(parser.takeChanges(inputs) == 2);
+  CHECK(inputs[0] == 3);
+  CHECK(inputs[1] == 41);
+  CHECK(parser.takeChanges(inputs) == 0);
+
+  // Only changed inputs are listed, also across word boundaries
+  line[9 + 2] = '0';
+  line[9 + 7] = '2';
+  line[9 + 8] = '1';
+  line[9 + 99] = '1';
+  feed(parser, line);
+
+  CHECK(parser.takeChanges(inputs) == 4);
+  CHECK(inputs[0] == 3);
+  CHECK(inputs[1] == 8);
+  CHECK(inputs[2] == 9);
+  CHECK(inputs[3] == 100);
+
+  // Inputs beyond a shorter line went off
+  feed(parser, "TALLY OK 000000021\r\n");
+  CHECK(parser.takeChanges(inputs) == 2);
+  CHECK(inputs[0] == 41);
+  CHECK(inputs[1] == 100);
+
+  // Only the first TallyChangesMaxValue are listed, all are counted
+  memset(line + 9, '1', TallyMaxLength);
+  strcpy(line + 9 + TallyMaxLength, "\r\n");
+  feed(parser, line);
+  CHECK(parser.takeChanges(inputs) == TallyMaxLength - 1);
+  CHECK(inputs[7] == 8);
+  CHECK(inputs[8] == 10);
+  CHECK(inputs[TallyChangesMaxValue - 1] == TallyChangesMaxValue + 1);
+}
+
+int main()
+{
+  testTallyStates();
+  testStateBeforeLineEnd();
+  testSplitLines();
+  testInputBeyondLine();
+  testCoalescing();
+  testMultipleInputs();
+  testSetInputsUsesLastLine();
+  testResponses();
+  testActs();
+  testActsSeedOnOverlay();
+  testChanges();
+
+  return CHECK_RESULT();
+}
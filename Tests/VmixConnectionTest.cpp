@@ -0,0 +1,276 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for the connection to vMix, against a fake vMix that refuses, stalls
+  and accepts connections
+*/
+
+#include <vector>
+#include "Check.h"
+#include "FakeVmix.h"
+#include "VmixConnection.h"
+
+char lastTally = 0;
+unsigned long tallies = 0;
+
+void onTally(char state)
+{
+  lastTally = state;
+  tallies++;
+}
+
+void onResponse(const char *response)
+{
+}
+
+void onState(VmixConnection::State state)
+{
+}
+
+// Follows the states of a connection and how long each one lasted
+struct Watch
+{
+  VmixConnection *connection;
+  VmixConnection::State state;
+  unsigned long since;
+  std::vector<unsigned long> backoffs;
+  std::vector<unsigned long> connecting;
+};
+
+// Runs the server and the connections for the given time, one millisecond per step
+void run(std::vector<Watch> &watches, FakeVmix *server, unsigned long time)
+{
+  for (unsigned long i = 0; i < time; i++)
+  {
+    if (server != NULL)
+    {
+      server->update();
+    }
+
+    for (size_t j = 0; j < watches.size(); j++)
+    {
+      Watch &watch = watches[j];
+
+      watch.connection->update();
+
+      if (watch.connection->state != watch.state)
+      {
+        if (watch.state == VmixConnection::StateBackoff)
+        {
+          watch.backoffs.push_back(millis() - watch.since);
+        }
+        else if (watch.state == VmixConnection::StateConnecting)
+        {
+          watch.connecting.push_back(millis() - watch.since);
+        }
+
+        watch.state = watch.connection->state;
+        watch.since = millis();
+      }
+    }
+
+    hostAdvanceMicros(1000);
+  }
+}
+
+Watch watch(VmixConnection &connection)
+{
+  Watch watch = {&connection, connection.state, millis()};
+
+  return watch;
+}
+
+// The longest backoff after the given number of failures in a row
+unsigned long maxBackoff(size_t failures)
+{
+  return failures < 16 && (BackoffMinDelay << failures) < BackoffMaxDelay ? BackoffMinDelay << failures : BackoffMaxDelay;
+}
+
+// A port nobody listens on
+uint16_t closedPort()
+{
+  FakeVmix server;
+
+  return server.port;
+}
+
+void testRefused()
+{
+  VmixConnection connection(onTally, onResponse, onState);
+  std::vector<Watch> watches;
+
+  connection.setSeed(1);
+  connection.begin("127.0.0.1", closedPort());
+  watches.push_back(watch(connection));
+  run(watches, NULL, 60000);
+
+  CHECK(!connection.connected());
+  CHECK(watches[0].backoffs.size() >= 6);
+  CHECK(connection.attempts == watches[0].connecting.size() || connection.attempts == watches[0].connecting.size() + 1);
+
+  // A refused connection fails at once, it never waits for the connect timeout
+  for (size_t i = 0; i < watches[0].connecting.size(); i++)
+  {
+    CHECK(watches[0].connecting[i] < 10);
+  }
+
+  // Every delay is between half and all of its exponential bound, which stops at the maximum
+  for (size_t i = 0; i < watches[0].backoffs.size(); i++)
+  {
+    unsigned long delay = watches[0].backoffs[i];
+
+    CHECK(delay >= maxBackoff(i) / 2);
+    CHECK(delay <= maxBackoff(i) + 1);
+  }
+
+  CHECK(maxBackoff(watches[0].backoffs.size() - 1) == BackoffMaxDelay);
+}
+
+void testStalled()
+{
+  FakeVmix server;
+  VmixConnection connection(onTally, onResponse, onState);
+  std::vector<Watch> watches;
+
+  server.setStalled(true);
+  connection.setSeed(2);
+  connection.begin("127.0.0.1", server.port);
+  watches.push_back(watch(connection));
+  run(watches, &server, 3000);
+
+  // A host that never answers the handshake costs one connect timeout per attempt
+  CHECK(!connection.connected());
+  CHECK(watches[0].connecting.size() >= 2);
+
+  for (size_t i = 0; i < watches[0].connecting.size(); i++)
+  {
+    CHECK(watches[0].connecting[i] >= ConnectTimeout);
+    CHECK(watches[0].connecting[i] <= ConnectTimeout + 2);
+  }
+
+  for (size_t i = 0; i < watches[0].backoffs.size(); i++)
+  {
+    CHECK(watches[0].backoffs[i] >= maxBackoff(i) / 2);
+    CHECK(watches[0].backoffs[i] <= maxBackoff(i) + 1);
+  }
+
+  // Once the host catches up the next attempt gets through
+  server.setStalled(false);
+  run(watches, &server, BackoffMaxDelay + 1000);
+  CHECK(connection.connected());
+}
+
+void testAccepted()
+{
+  FakeVmix server;
+  VmixConnection connection(onTally, onResponse, onState);
+  std::vector<Watch> watches;
+  const uint16_t inputs[] = {2};
+
+  server.setTally("0120");
+  connection.setSeed(3);
+  connection.setInputs(inputs, 1, 0);
+  connection.begin("127.0.0.1", server.port);
+  watches.push_back(watch(connection));
+  run(watches, &server, 100);
+
+  CHECK(connection.connected());
+  CHECK(connection.attempts == 1);
+  CHECK(connection.connectDuration < 10);
+  CHECK(lastTally == '1');
+
+  server.setTally("0210");
+  run(watches, &server, 10);
+  CHECK(lastTally == '2');
+
+  // A dropped connection starts over at the shortest backoff, earlier failures are forgotten
+  server.closeAll();
+  run(watches, &server, 100);
+  CHECK(!connection.connected());
+  CHECK(connection.reconnects == 1);
+
+  run(watches, &server, BackoffMinDelay + 100);
+  CHECK(connection.connected());
+  CHECK(watches[0].backoffs.size() == 1);
+  CHECK(watches[0].backoffs[0] >= BackoffMinDelay / 2);
+  CHECK(watches[0].backoffs[0] <= BackoffMinDelay + 1);
+  CHECK(lastTally == '2');
+}
+
+void testLookup()
+{
+  FakeVmix server;
+  VmixConnection connection(onTally, onResponse, onState);
+  std::vector<Watch> watches;
+
+  connection.begin("localhost", server.port);
+  watches.push_back(watch(connection));
+  run(watches, &server, 100);
+
+  CHECK(connection.connected());
+}
+
+void testJitterSpread()
+{
+  const int Count = 16;
+  VmixConnection *connections[Count];
+  std::vector<Watch> watches;
+  uint16_t port = closedPort();
+  unsigned long lowest = BackoffMaxDelay;
+  unsigned long highest = 0;
+  int distinct = 0;
+
+  // Tallies that lost the same host all retry, the jitter keeps them apart
+  for (int i = 0; i < Count; i++)
+  {
+    connections[i] = new VmixConnection(onTally, onResponse, onState);
+    connections[i]->setSeed(0x00C0FFEE + i);
+    connections[i]->begin("127.0.0.1", port);
+    watches.push_back(watch(*connections[i]));
+  }
+
+  run(watches, NULL, BackoffMinDelay + 100);
+
+  for (int i = 0; i < Count; i++)
+  {
+    bool unique = true;
+
+    CHECK(watches[i].backoffs.size() == 1);
+    unsigned long delay = watches[i].backoffs[0];
+
+    CHECK(delay >= BackoffMinDelay / 2);
+    CHECK(delay <= BackoffMinDelay + 1);
+
+    lowest = delay < lowest ? delay : lowest;
+    highest = delay > highest ? delay : highest;
+
+    for (int j = 0; j < i; j++)
+    {
+      unique = unique && watches[j].backoffs[0] != delay;
+    }
+
+    distinct += unique;
+  }
+
+  CHECK(highest - lowest >= BackoffMinDelay / 4);
+  CHECK(distinct >= Count * 3 / 4);
+
+  for (int i = 0; i < Count; i++)
+  {
+    delete connections[i];
+  }
+}
+
+int main()
+{
+  hostSetMicros(1000000);
+
+  testRefused();
+  testStalled();
+  testAccepted();
+  testLookup();
+  testJitterSpread();
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,160 @@
+/*
+  vMix wireless tally
+  Copyright 2019 Thomas Mout
+
+  Tests for joining WiFi while loop() keeps running, over the simulated access point
+*/
+
+#include "Arduino-vMix-Tally.ino.cpp"
+#include "Check.h"
+#include "FakeVmix.h"
+
+FakeVmix vmixHost;
+
+// Runs loop() until the tally saw the WiFi connection, one millisecond per step
+void runUntilConnected()
+{
+  for (unsigned long i = 0; i < WifiTimeout && wifiConnecting; i++)
+  {
+    loop();
+    hostAdvanceMicros(1000);
+  }
+}
+
+// Runs loop() and vMix until the tally shows its first state
+void runUntilFirstTally()
+{
+  for (int i = 0; i < 5000 && !(bootStagesSeen & (1 << BootFirstTally)); i++)
+  {
+    vmixHost.update();
+    loop();
+    hostAdvanceMicros(1000);
+  }
+}
+
+// Start over the way a power cycle does, setup() itself only runs once
+void boot()
+{
+  bootStagesSeen = 0;
+  loopTime.reset();
+  start();
+}
+
+unsigned long bootToConnected()
+{
+  return bootStages[BootWifiConnected] - bootStages[BootSettings];
+}
+
+// How connectToWifi() waited for the connection before it moved into loop()
+unsigned long blockingBootToConnected()
+{
+  unsigned long begin = millis();
+  int timeout = 15;
+
+  WiFi.mode(WIFI_STA);
+  WiFi.hostname(deviceName);
+  WiFi.begin(settings.ssid, settings.pass);
+
+  while (WiFi.status() != WL_CONNECTED and timeout > 0)
+  {
+    delay(1000);
+    timeout--;
+  }
+
+  return millis() - begin;
+}
+
+void testScanJoin()
+{
+  unsigned long joinTime = hostWifi.scanTime + hostWifi.associateTime + hostWifi.dhcpTime;
+
+  EEPROM.hostErase();
+  unsigned long before = blockingBootToConnected();
+
+  EEPROM.hostErase();
+  boot();
+  CHECK(wifiConnecting);
+
+  // The web server and the display keep running while the station joins
+  for (int i = 0; i < 1000; i++)
+  {
+    loop();
+    hostAdvanceMicros(1000);
+  }
+
+  CHECK(wifiConnecting);
+  CHECK(httpServer.hostRequest(HTTP_GET, "/api/status"));
+  CHECK(httpServer.response.code == 200);
+  CHECK(!matrix.busy());
+
+  runUntilConnected();
+
+  // The connection is seen within a loop pass instead of on the next whole second
+  unsigned long after = bootToConnected();
+
+  printf("Boot to WiFi connected with a scan: %lu ms blocking, %lu ms in loop()\n", before, after);
+  CHECK(!wifiConnecting);
+  CHECK(WiFi.status() == WL_CONNECTED);
+  CHECK(before >= joinTime);
+  CHECK(after >= joinTime);
+  CHECK(after <= joinTime + 2);
+  CHECK(after < before);
+  CHECK(loopTime.max < 1000);
+}
+
+void testFastJoin()
+{
+  unsigned long scans = hostWifi.scans;
+
+  strcpy(settings.hostName, "127.0.0.1");
+  saveSettings();
+  port = vmixHost.port;
+  vmixHost.setTally("1");
+
+  // The last join cached the access point, so there is no scan
+  boot();
+  runUntilFirstTally();
+
+  printf("Boot to WiFi connected with the cached access point: %lu ms, to the first tally: %lu ms\n", bootToConnected(),
+         bootStages[BootFirstTally] - bootStages[BootSettings]);
+  CHECK(hostWifi.scans == scans);
+  CHECK(bootToConnected() <= hostWifi.associateTime + hostWifi.dhcpTime + 2);
+  CHECK(bootStages[BootFirstTally] - bootStages[BootSettings] < 1000);
+  CHECK(currentState == '1');
+
+  // The address still comes from DHCP, so the lease is renewed
+  CHECK(hostWifi.staticConfigs == 0);
+  CHECK(WiFi.localIP() == hostWifi.ip);
+}
+
+void testMovedAccessPoint()
+{
+  WifiCache cache;
+
+  // A replaced access point is not found on the cached BSSID, a scan finds the new one
+  hostWifi.bssid[5] = 0x02;
+  boot();
+  runUntilConnected();
+
+  CHECK(WiFi.status() == WL_CONNECTED);
+  CHECK(bootToConnected() >= WifiFastTimeout);
+  CHECK(bootToConnected() <= WifiFastTimeout + hostWifi.scanTime + hostWifi.associateTime + hostWifi.dhcpTime + 2);
+
+  EEPROM.get(WifiCacheAddress, cache);
+  CHECK(cache.magic == WifiCacheMagic);
+  CHECK(memcmp(cache.bssid, hostWifi.bssid, sizeof(cache.bssid)) == 0);
+  CHECK(hostWifi.staticConfigs == 0);
+}
+
+int main()
+{
+  hostSetMicros(1000000);
+  EEPROM.hostErase();
+  setup();
+
+  testScanJoin();
+  testFastJoin();
+  testMovedAccessPoint();
+
+  return CHECK_RESULT();
+}